@@ -0,0 +1,223 @@
+#include "include/simba/simba.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// Checks that serializing makes no heap allocations, every operator new in the process is counted.
+
+namespace {
+	std::atomic<std::size_t> allocationCount{ 0u };
+
+	void* allocate(std::size_t size)
+	{
+		allocationCount.fetch_add(1u, std::memory_order_relaxed);
+
+		if (void* memory = std::malloc(size != 0u ? size : 1u)) {
+			return memory;
+		}
+
+		throw std::bad_alloc();
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	allocationCount.fetch_add(1u, std::memory_order_relaxed);
+	const auto align = static_cast<std::size_t>(alignment);
+
+#if defined(_MSC_VER)
+	void* memory = _aligned_malloc(size != 0u ? size : 1u, align);
+#else
+	void* memory = std::aligned_alloc(align, (size + align - 1u) / align * align);
+#endif
+
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+namespace {
+	int failures = 0;
+
+	// discards the output, so only the serializer's own allocations are counted
+	class null_buffer : public std::streambuf
+	{
+	protected:
+		std::streamsize xsputn(const char*, std::streamsize count) override
+		{
+			return count;
+		}
+
+		int_type overflow(int_type ch) override
+		{
+			return traits_type::not_eof(ch);
+		}
+	};
+
+	template<typename Function>
+	void expectAllocations(const char* what, std::size_t expected, Function function)
+	{
+		const auto before = allocationCount.load();
+		function();
+		const auto allocations = allocationCount.load() - before;
+
+		if (allocations != expected) {
+			std::cout << "FAILED: " << what << " made " << allocations << " allocation(s) instead of " << expected << std::endl;
+			++failures;
+		}
+	}
+
+	template<typename Function>
+	void expectNoAllocations(const char* what, Function function)
+	{
+		expectAllocations(what, 0u, function);
+	}
+
+	simba::simba_value makeValue()
+	{
+		auto records = simba::array();
+
+		for (int i = 0; i < 100; ++i) {
+			records.emplaceBack(simba::object(
+				simba::pair("id", static_cast<std::int64_t>(i)),
+				simba::pair("name", "a name long enough to be stored on the heap, record " + std::to_string(i)),
+				simba::pair("score", i * 0.25),
+				simba::pair("flags", simba::array(i % 2, static_cast<std::uint16_t>(i), "short")),
+				simba::pair("samples", simba::typed_array(std::vector<std::int32_t>{ i, i + 1, i + 2 }))
+			));
+		}
+
+		return simba::object(
+			simba::pair("records", std::move(records)),
+			simba::pair("wide", std::wstring(L"wide string")),
+			simba::pair("empty", simba::object())
+		);
+	}
+
+	void checkValue(const char* tree, const simba::simba_value& value, std::uint8_t format)
+	{
+		const auto name = [&](const char* path) {
+			return std::string(tree) + (format == simba::SIMBA_FORMAT_V1 ? ", v1: " : ", v2: ") + path;
+		};
+
+		std::vector<char> buffer(value.serialize().format(format).size());
+		null_buffer discard;
+		std::ostream stream{ &discard };
+
+		const auto size = name("size()");
+		expectNoAllocations(size.c_str(), [&] {
+			value.serialize().format(format).size();
+		});
+
+		const auto toBuffer = name("toBuffer(ptr)");
+		expectNoAllocations(toBuffer.c_str(), [&] {
+			value.serialize().format(format).toBuffer(buffer.data(), buffer.size());
+		});
+
+		// the result is the only allocation, this also shows the counter sees the serializer's allocations
+		const auto toString = name("toString()");
+		expectAllocations(toString.c_str(), 1u, [&] {
+			value.serialize().format(format).toString();
+		});
+
+		const auto toStream = name("to(ostream)");
+		expectNoAllocations(toStream.c_str(), [&] {
+			simba::details::simba_stream_output_adapter adapter{ stream };
+			value.serialize().format(format).to(adapter);
+		});
+	}
+}
+
+int main()
+{
+	const auto owned = makeValue();
+
+	// the records are shared with another value, so the tree is immutable and caches its sizes
+	const auto records = owned.get<simba::simba_value::simba_object_type>().at("records").share();
+	const auto shared = simba::object(
+		simba::pair("records", records.share()),
+		simba::pair("copy", records.share())
+	);
+
+	for (const auto format : { simba::SIMBA_FORMAT_V1, simba::SIMBA_FORMAT_V2 }) {
+		checkValue("owned", owned, format);
+		checkValue("shared", shared, format);
+	}
+
+	null_buffer discard;
+	std::ostream stream{ &discard };
+	expectNoAllocations("operator<<", [&] {
+		stream << owned;
+	});
+
+	if (failures != 0) {
+		std::cout << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "No allocations while serializing" << std::endl;
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "include/simba/simba.h"
+#include <chrono>
+#include <iostream>
+
+// Encodes and decodes the same value through the virtual adapter interface and through
+// the templated to()/from() overloads, which dispatch the adapter calls statically.
+// Decoding builds a new tree every round, both decode timings include those allocations.
+
+namespace {
+	constexpr int RECORDS = 200000;
+	constexpr int ROUNDS = 10;
+
+	simba::simba_value makeValue()
+	{
+		auto records = simba::array();
+
+		for (int i = 0; i < RECORDS; ++i) {
+			records.emplaceBack(simba::object(
+				simba::pair("id", static_cast<std::int64_t>(i)),
+				simba::pair("name", "user-" + std::to_string(i)),
+				simba::pair("score", i * 0.25),
+				simba::pair("flags", simba::array(i % 2, i % 3, i % 5))
+			));
+		}
+
+		return records;
+	}
+
+	template<typename Function>
+	double measure(Function function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < ROUNDS; ++i) {
+			function();
+		}
+
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+	}
+
+	void report(const char* name, double virtualTime, double staticTime)
+	{
+		std::cout << name << ": virtual " << virtualTime << " ms, static " << staticTime << " ms ("
+			<< (virtualTime / staticTime) << "x)" << std::endl;
+	}
+}
+
+int main()
+{
+	const auto value = makeValue();
+
+	// allocated once up front, every round writes into it through a pointer adapter (a bounds check and a
+	// memcpy per write), so the rounds measure the serializer and its adapter calls rather than the output
+	std::vector<char> buffer(value.serialize().size());
+	std::size_t written = 0u;
+
+	const auto encodeVirtual = measure([&] {
+		simba::details::simba_pointer_output_adapter adapter{ buffer.data(), buffer.size() };
+		value.serialize().to(static_cast<simba::details::simba_output_adapter&>(adapter));
+		written = adapter.written();
+	});
+	const auto encodeStatic = measure([&] {
+		simba::details::simba_pointer_output_adapter adapter{ buffer.data(), buffer.size() };
+		value.serialize().to(adapter);
+		written = adapter.written();
+	});
+
+	simba::simba_value decoded;
+	const auto decodeVirtual = measure([&] {
+		simba::details::simba_memory_input_adapter adapter{ buffer.data(), written };
+		decoded.deserialize().from(static_cast<simba::details::simba_input_adapter&>(adapter));
+	});
+	const auto decodeStatic = measure([&] {
+		simba::details::simba_memory_input_adapter adapter{ buffer.data(), written };
+		decoded.deserialize().from(adapter);
+	});
+
+	if (decoded != value) {
+		std::cout << "Decoded value differs from the original" << std::endl;
+		return 1;
+	}
+
+	std::cout << RECORDS << " records, " << written << " bytes" << std::endl;
+	report("encode", encodeVirtual, encodeStatic);
+	report("decode", decodeVirtual, decodeStatic);
+	return 0;
+}
@@ -23,21 +23,81 @@ SOFTWARE.
 *************************************************************************************/
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <map>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <stdexcept>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <memory>
+#include <utility>
+
+// byte swapping of whole buffers uses pshufb when the target supports it, define SIMBA_NO_SIMD to always use the scalar loop
+#if !defined(SIMBA_NO_SIMD) && defined(__AVX2__)
+#define SIMBA_SIMD_AVX2
+#endif
+#if !defined(SIMBA_NO_SIMD) && (defined(__SSSE3__) || defined(__AVX__))
+#define SIMBA_SIMD_SSSE3
+#endif
+#if defined(SIMBA_SIMD_AVX2) || defined(SIMBA_SIMD_SSSE3)
+#include <immintrin.h>
+#endif
+
+// files are written with writev and read through mmap on posix systems,
+// large string payloads are handed to the kernel in place and input is decoded straight from the page cache
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMBA_HAS_WRITEV
+#define SIMBA_HAS_MMAP
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <system_error>
+#endif
 
 namespace simba {
 	constexpr auto VERSION_STRING = "1.0.0";
 	constexpr const char SIMBA_HEADER[] = { 'S', 'I', 'M', 'B', 'A' };
 	constexpr auto SIMBA_HEADER_LEN = sizeof(SIMBA_HEADER);
 
+	// wire format versions, v1 files can still be read but new files are written as SIMBA_FORMAT_VERSION
+	constexpr std::uint8_t SIMBA_FORMAT_V1 = 1u;
+	constexpr std::uint8_t SIMBA_FORMAT_V2 = 2u;
+	constexpr std::uint8_t SIMBA_FORMAT_VERSION = SIMBA_FORMAT_V2;
+
 	class simba_value;
 
+	class simba_key;
+	class simba_key_table;
+
+	template<typename Key, typename T, typename Compare = std::less<>, typename Allocator = std::allocator<std::pair<Key, T>>>
+	class simba_flat_map;
+
+	class simba_document;
+
+	class simba_view;
+	class simba_view_ref;
+
 	template<typename T>
-	std::pair<std::string, simba_value> pair(std::string str, T value);
+	std::pair<simba_key, simba_value> pair(simba_key key, T&& value);
 
 	template<typename T>
 	static simba_value val(T&& value);
@@ -50,7 +110,57 @@ namespace simba {
 	template<typename ...Args>
 	static simba_value object(Args&& ...args);
 
+	template<typename T>
+	static simba_value typed_array(const T* data, std::size_t count);
+
+	template<typename T>
+	static simba_value typed_array(const std::vector<T>& values);
+
 	namespace details {
+		// set in the endianess byte of the header when a version and flags byte follow (format v2 and up)
+		constexpr std::uint8_t SIMBA_HEADER_EXTENDED = 0x80u;
+
+		// feature flags, the byte following the version in the extended header
+		constexpr std::uint8_t SIMBA_FLAG_COMPRESSED = 0x01u; // everything after the header is stored in compressed blocks
+		constexpr std::uint8_t SIMBA_FLAG_STRING_TABLE = 0x02u; // repeated strings are stored once, in a table before the value
+		constexpr std::uint8_t SIMBA_FLAG_INDEX = 0x04u; // the offsets of the children of large containers follow the value
+		constexpr std::uint8_t SIMBA_SUPPORTED_FLAGS = SIMBA_FLAG_COMPRESSED | SIMBA_FLAG_STRING_TABLE | SIMBA_FLAG_INDEX;
+
+		// strings shorter than this are cheaper to repeat than to reference
+		constexpr std::size_t SIMBA_MIN_TABLE_STRING = 3u;
+
+		// arrays and objects with fewer children are cheaper to walk than to index
+		constexpr std::uint32_t SIMBA_MIN_INDEXED_COUNT = 64u;
+
+		// distinct keys a deserializer keeps acquired, keys past it go to the global table every time
+		constexpr std::size_t SIMBA_KEY_CACHE_SIZE = 1024u;
+
+		// largest string chunk a simba_reader hands out at once
+		constexpr std::size_t SIMBA_READER_CHUNK = 64 * 1024;
+
+		// open simba_writer containers reserve this many bytes for a count of up to 2^32 - 1
+		constexpr std::size_t SIMBA_WRITER_COUNT_BYTES = 5u;
+
+		// block compression, a small LZ77 codec in the spirit of LZ4
+		constexpr std::size_t SIMBA_BLOCK_SIZE = 64 * 1024; // offsets within a block fit in 16 bits
+		constexpr std::size_t SIMBA_LZ_MIN_MATCH = 4u;
+		constexpr unsigned SIMBA_LZ_HASH_BITS = 12u;
+		constexpr std::size_t SIMBA_LZ_HASH_SIZE = std::size_t{ 1u } << SIMBA_LZ_HASH_BITS;
+
+		// format v2 tags, 0x00-0x1F are regular tags (type | flag << 4), the others carry a small value inline
+		constexpr std::uint8_t SIMBA_TAG_TINYINT = 0x20u;   // | (type - int8) << 3 | unsigned << 2 | value 0-3
+		constexpr std::uint8_t SIMBA_TAG_FIXSTR = 0x40u;    // | length 0-31, followed by the characters
+		constexpr std::uint8_t SIMBA_TAG_FIXARRAY = 0x60u;  // | count 0-15, followed by the elements
+		constexpr std::uint8_t SIMBA_TAG_FIXOBJECT = 0x70u; // | count 0-15, followed by the key/value pairs
+		constexpr std::uint8_t SIMBA_TAG_FIXINT = 0x80u;    // | value 0-127 of a signed 32 bit integer
+		constexpr std::uint8_t SIMBA_TAG_STRINGREF = 0x0Fu; // no type uses it, followed by a string table index
+
+		// typed array element tag bits besides type | flag << 4 (v2)
+		constexpr std::uint8_t SIMBA_ELEMENT_PACKED = 0x80u;   // integers are delta, frame of reference and bit-packed
+		constexpr std::uint8_t SIMBA_ELEMENT_AS_ARRAY = 0x40u; // packed regular array, read back as an array of values
+		constexpr std::size_t SIMBA_MIN_PACKED_COUNT = 16u;    // shorter regular arrays are never packed
+		constexpr std::uint8_t SIMBA_MAX_PACKED_WIDTH = 56u;   // a packed value and its bit offset fit in one 64 bit load
+
 		static std::uint8_t swap_uint8(std::uint8_t val);
 		static std::int8_t swap_int8(std::int8_t val);
 		static std::uint16_t swap_uint16(std::uint16_t val);
@@ -59,8 +169,78 @@ namespace simba {
 		static std::int32_t swap_int32(std::int32_t val);
 		static std::int64_t swap_int64(std::int64_t val);
 		static std::uint64_t swap_uint64(std::uint64_t val);
+		template<typename T>
+		static T swap_integer(T val);
+		template<typename T>
+		static void swap_buffer(T* data, std::size_t count);
+		template<std::size_t Width>
+		struct swap_shuffle;
+		template<std::size_t Width>
+		static std::size_t swap_buffer_simd(unsigned char* data, std::size_t count);
+		template<typename T>
+		static std::uint64_t to_bits(T value);
+		template<typename T>
+		static T from_bits(std::uint64_t bits);
+		static std::uint64_t zigzag(std::int64_t val);
+		static std::int64_t unzigzag(std::uint64_t val);
+		template<typename T>
+		static T narrow_varint(std::uint64_t val);
 		static std::uint8_t getEndianess();
 		static bool hasTypeFlag(const std::uint8_t& type);
+		static bool isSimpleType(const std::uint8_t& type);
+
+		template<typename T, typename = void>
+		struct has_reserve;
+
+		template<typename Container>
+		static void reserve(Container& container, std::size_t count);
+
+		// adapter "concepts", checked by the statically dispatched serializer/deserializer front-ends
+		template<typename T, typename = void>
+		struct is_output_adapter;
+
+		template<typename T, typename = void>
+		struct is_input_adapter;
+
+		template<typename T, typename = void>
+		struct has_flush;
+
+		// adapters that can reference a payload until their next flush instead of copying it
+		template<typename T, typename = void>
+		struct has_write_reference;
+
+		// adapters that know the offset they're writing at
+		template<typename T>
+		struct is_offset_adapter;
+
+		// adapters that can replace bytes they wrote before, simba_writer patches counts with it
+		template<typename T, typename = void>
+		struct has_overwrite;
+
+		// adapters that can tell up front whether overwrite() will work, e.g. only on a seekable output
+		template<typename T, typename = void>
+		struct has_can_overwrite;
+
+		template<typename Container>
+		struct simba_node;
+
+		// simba type and flag of the element types typed arrays support
+		template<typename T>
+		struct typed_element;
+
+		template<typename F>
+		static bool visitElementType(std::uint8_t type, std::uint8_t flag, F&& f);
+
+		template<typename F>
+		static void parallel_for(std::size_t threads, std::size_t first, std::size_t last, F&& f);
+
+		static std::uint8_t bit_width(std::uint64_t value);
+		static std::size_t varint_length(std::uint64_t value);
+		static void unpack_deltas(const unsigned char* packed, std::size_t count, std::uint8_t width, std::uint64_t previous, std::uint64_t reference, std::uint64_t* out);
+
+		static std::size_t lz_bound(std::size_t length);
+		static std::size_t lz_compress(const char* source, std::size_t length, char* dest, std::uint16_t* table);
+		static void lz_decompress(const char* source, std::size_t length, char* dest, std::size_t rawLength);
 
 		template<typename ...Args>
 		struct array_impl;
@@ -71,15 +251,41 @@ namespace simba {
 		// Output
 		class simba_output_adapter;
 		class simba_stream_output_adapter;
+		template<typename Container>
+		class simba_buffer_output_adapter;
+		class simba_pointer_output_adapter;
+		class simba_size_output_adapter;
+		template<typename Adapter>
+		class simba_compress_output_adapter;
+		template<typename Adapter>
+		class simba_offset_output_adapter;
+#if defined(SIMBA_HAS_WRITEV)
+		class simba_fd_output_adapter;
+#endif
 		class simba_serializer;
 
 		// Input
 		class simba_input_adapter;
+		class simba_memory_input_adapter;
 		class simba_string_input_adapter;
 		class simba_stream_input_adapter;
+#if defined(SIMBA_HAS_MMAP)
+		class simba_mmap_input_adapter;
+#endif
+		template<typename Adapter>
+		class simba_decompress_input_adapter;
 		class simba_deserializer;
+
+		// decoded header of an element seen through a simba_view
+		struct view_element;
 	}
 
+	template<typename Adapter = details::simba_input_adapter>
+	class simba_reader;
+
+	template<typename Adapter = details::simba_output_adapter>
+	class simba_writer;
+
 	enum simba_endianess : std::uint8_t {
 		default_endianess,
 		little_endian,
@@ -100,7 +306,8 @@ namespace simba {
 		simba_type_string8,
 		simba_type_string16,
 		simba_type_string32,
-		simba_type_string_w
+		simba_type_string_w,
+		simba_type_typed_array // contiguous elements of a single arithmetic type
 	};
 
 	enum simba_type_flag_t : std::uint8_t {
@@ -108,1781 +315,7512 @@ namespace simba {
 		simba_type_flag_unsigned
 	};
 
-	class simba_value
+	// what simba_reader::next() found
+	enum simba_event_t : std::uint8_t {
+		simba_event_end_of_input, // the root value has been read completely
+		simba_event_begin_array,  // size() elements follow, then simba_event_end_array
+		simba_event_begin_object, // size() pairs follow, a key event and the value each, then simba_event_end_object
+		simba_event_key,
+		simba_event_value,        // a number or null
+		simba_event_string,       // a chunk of a string, see chunk() and isLastChunk()
+		simba_event_end_array,
+		simba_event_end_object
+	};
+
+	// Process wide pool of object keys, every distinct key that is in use is stored exactly once.
+	// Entries are reference counted by the simba_keys pointing at them and freed with the last one,
+	// so keys from short lived objects or untrusted input don't accumulate.
+	class simba_key_table
 	{
-	public: // public types and func prototypes
-		using simba_object_type = std::map<std::string, simba_value>;
-		using simba_map_type = simba_object_type;
-		using simba_array_type = std::vector<simba_value>;
+	public:
+		// a pooled key and the number of simba_keys holding it
+		struct entry
+		{
+			explicit entry(std::string_view key)
+				: str(key)
+			{}
 
-		union simba_simple_type {
-			std::int8_t int8;
-			std::uint8_t uint8;
-			std::int16_t int16;
-			std::uint16_t uint16;
-			std::int32_t int32;
-			std::uint32_t uint32;
-			std::int64_t int64;
-			std::uint64_t uint64;
-			float floatVal;
-			double doubleVal;
+			std::string str;
+			std::atomic<std::size_t> refs{ 1u };
 		};
 
-	public: // Constructors
-		simba_value()
-		{}
-		simba_value(std::nullptr_t)
-			: simba_value()
-		{}
-		simba_value(const simba_value& other)
+		// never destroyed, keys in static values may outlive any static table
+		static simba_key_table& global()
 		{
-			*this = other;
+			static simba_key_table* table = new simba_key_table();
+			return *table;
 		}
-		simba_value(simba_value&& other) noexcept
+
+		// the empty key, shared by every empty or moved from simba_key and never freed
+		static entry* empty() noexcept
 		{
-			*this = std::move(other);
+			static entry emptyKey{ std::string_view{} };
+			return &emptyKey;
 		}
-		simba_value(const std::int8_t& int8)
-			: simba_value()
+
+		// Returns the pooled copy of key with a reference taken, only allocates if no live key holds it.
+		// Entries whose count dropped to zero are never revived, their last holder is about to free them.
+		entry* acquire(std::string_view key)
 		{
-			*this = int8;
+			if (key.empty()) {
+				return simba_key_table::empty();
+			}
+
+			{
+				std::shared_lock<std::shared_mutex> lock{ this->mutex };
+				auto it = this->index.find(key);
+
+				if (it != this->index.end() && simba_key_table::retain(it->second)) {
+					return it->second;
+				}
+			}
+
+			std::unique_lock<std::shared_mutex> lock{ this->mutex };
+			auto it = this->index.find(key);
+
+			if (it != this->index.end() && simba_key_table::retain(it->second)) {
+				return it->second; // someone else interned it meanwhile
+			}
+
+			auto pooled = std::make_unique<entry>(key);
+
+			if (it != this->index.end()) {
+				// replaces an entry that is being released, its node is keyed by the string that is about to be freed
+				auto node = this->index.extract(it);
+				node.key() = std::string_view{ pooled->str };
+				node.mapped() = pooled.get();
+				this->index.insert(std::move(node));
+			}
+			else {
+				this->index.emplace(std::string_view{ pooled->str }, pooled.get());
+			}
+
+			return pooled.release();
 		}
-		simba_value(const std::uint8_t& uint8)
-			: simba_value()
+
+		// takes another reference to an entry that is known to be alive
+		static void addRef(entry* pooled) noexcept
 		{
-			*this = uint8;
+			if (pooled != simba_key_table::empty()) {
+				pooled->refs.fetch_add(1u, std::memory_order_relaxed);
+			}
 		}
-		simba_value(const std::int16_t& int16)
-			: simba_value()
+
+		// drops a reference, the last one removes the entry from the pool and frees it
+		void release(entry* pooled) noexcept
 		{
-			*this = int16;
+			if (pooled == simba_key_table::empty() || pooled->refs.fetch_sub(1u, std::memory_order_acq_rel) != 1u) {
+				return;
+			}
+
+			{
+				std::unique_lock<std::shared_mutex> lock{ this->mutex };
+				auto it = this->index.find(std::string_view{ pooled->str });
+
+				if (it != this->index.end() && it->second == pooled) {
+					this->index.erase(it);
+				}
+			}
+
+			delete pooled;
 		}
-		simba_value(const std::uint16_t& uint16)
-			: simba_value()
+
+		// number of distinct keys in use
+		std::size_t size() const
 		{
-			*this = uint16;
+			std::shared_lock<std::shared_mutex> lock{ this->mutex };
+			return this->index.size();
 		}
-		simba_value(const std::int32_t& int32)
-			: simba_value()
+
+	private:
+		simba_key_table() = default;
+
+		// increments unless the count already dropped to zero
+		static bool retain(entry* pooled) noexcept
 		{
-			*this = int32;
+			auto refs = pooled->refs.load(std::memory_order_relaxed);
+
+			while (refs != 0u) {
+				if (pooled->refs.compare_exchange_weak(refs, refs + 1u, std::memory_order_relaxed)) {
+					return true;
+				}
+			}
+
+			return false;
 		}
-		simba_value(const std::uint32_t& uint32)
-			: simba_value()
+
+	private:
+		mutable std::shared_mutex mutex;
+		std::unordered_map<std::string_view, entry*> index;
+	};
+
+	// Object key, a counted handle to a string pooled in the global simba_key_table.
+	// Since every distinct key in use exists exactly once equality and hashing only look at the pointer,
+	// ordering still compares the characters so objects keep a stable, sorted iteration order.
+	class simba_key
+	{
+	public:
+		simba_key() noexcept
+			: pooled(simba_key_table::empty())
+		{}
+		simba_key(std::string_view key)
+			: pooled(simba_key_table::global().acquire(key))
+		{}
+		simba_key(const std::string& key)
+			: simba_key(std::string_view{ key })
+		{}
+		simba_key(const char* key)
+			: simba_key(std::string_view{ key })
+		{}
+		simba_key(const simba_key& other) noexcept
+			: pooled(other.pooled)
 		{
-			*this = uint32;
+			simba_key_table::addRef(this->pooled);
 		}
-		simba_value(const std::int64_t& int64)
-			: simba_value()
+		simba_key(simba_key&& other) noexcept
+			: pooled(std::exchange(other.pooled, simba_key_table::empty()))
+		{}
+		~simba_key()
 		{
-			*this = int64;
+			simba_key_table::global().release(this->pooled);
 		}
-		simba_value(const std::uint64_t& uint64)
-			: simba_value()
+
+		simba_key& operator=(const simba_key& other) noexcept
 		{
-			*this = uint64;
+			simba_key_table::addRef(other.pooled);
+			simba_key_table::global().release(std::exchange(this->pooled, other.pooled));
+			return *this;
 		}
-		simba_value(const float& floatVal)
-			: simba_value()
+
+		simba_key& operator=(simba_key&& other) noexcept
 		{
-			*this = floatVal;
+			if (this != &other) {
+				simba_key_table::global().release(std::exchange(this->pooled, std::exchange(other.pooled, simba_key_table::empty())));
+			}
+
+			return *this;
 		}
-		simba_value(const double& doubleVal)
-			: simba_value()
+
+	public:
+		const std::string& string() const noexcept
 		{
-			*this = doubleVal;
+			return this->pooled->str;
 		}
-		simba_value(std::string string)
-			: simba_value()
+
+		const char* c_str() const noexcept
 		{
-			*this = std::move(string);
+			return this->pooled->str.c_str();
 		}
-		simba_value(std::wstring wstring)
-			: simba_value()
+
+		const char* data() const noexcept
 		{
-			*this = std::move(wstring);
+			return this->pooled->str.data();
 		}
-		simba_value(std::u16string u16string)
-			: simba_value()
+
+		std::size_t length() const noexcept
 		{
-			*this = std::move(u16string);
+			return this->pooled->str.length();
 		}
-		simba_value(std::u32string u32string)
-			: simba_value()
+
+		operator const std::string& () const noexcept
 		{
-			*this = std::move(u32string);
+			return this->pooled->str;
 		}
-		simba_value(std::vector<simba_value> arrayValue)
-			: simba_value()
+
+		operator std::string_view() const noexcept
 		{
-			*this = std::move(arrayValue);
+			return this->pooled->str;
 		}
-		simba_value(std::initializer_list<simba_value> arrayValue)
-			: simba_value()
+
+	public:
+		friend bool operator==(const simba_key& lhs, const simba_key& rhs) noexcept
 		{
-			*this = simba_array_type{ std::move(arrayValue) };
+			return lhs.pooled == rhs.pooled;
 		}
-		simba_value(std::map<std::string, simba_value> objectValue)
-			: simba_value()
+
+		friend bool operator!=(const simba_key& lhs, const simba_key& rhs) noexcept
 		{
-			*this = std::move(objectValue);
+			return lhs.pooled != rhs.pooled;
 		}
-		simba_value(std::initializer_list<std::pair<std::string, simba_value>> objectValue)
-			: simba_value()
+
+		friend bool operator<(const simba_key& lhs, const simba_key& rhs) noexcept
 		{
-			*this = std::map<std::string, simba_value>(objectValue.begin(), objectValue.end());
+			return lhs.pooled != rhs.pooled && lhs.pooled->str < rhs.pooled->str;
 		}
-		~simba_value()
+
+		// comparisons against anything string like, these make lookups with std::less<> transparent
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator==(const simba_key& lhs, const T& rhs) noexcept
 		{
-			this->destroyPtr();
+			return std::string_view{ lhs.pooled->str } == std::string_view{ rhs };
 		}
 
-	public: // general functions
-		void abandon() // abandon ownership of any ptrs
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator==(const T& lhs, const simba_key& rhs) noexcept
 		{
-			this->simbaType = simba_type_null;
-			this->simpleValue = nullptr;
-			this->objectValue = nullptr;
-			this->arrayValue = nullptr;
-			this->string = nullptr;
-			this->u16string = nullptr;
-			this->u32string = nullptr;
-			this->wstring = nullptr;
+			return rhs == lhs;
 		}
 
-		// type, one of simba_type_t
-		const std::uint8_t& getType() const noexcept
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator!=(const simba_key& lhs, const T& rhs) noexcept
 		{
-			return this->simbaType;
+			return !(lhs == rhs);
 		}
 
-		// type flag, one of simba_type_flag_t
-		// only releveant on types that can be signed/unsigned
-		const std::uint8_t& getTypeFlag() const noexcept
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator!=(const T& lhs, const simba_key& rhs) noexcept
 		{
-			return this->simbaTypeFlag;
+			return !(rhs == lhs);
 		}
 
-		inline bool isSigned() const noexcept
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator<(const simba_key& lhs, const T& rhs) noexcept
 		{
-			return this->simbaTypeFlag == simba_type_flag_signed;
+			return std::string_view{ lhs.pooled->str } < std::string_view{ rhs };
 		}
 
-		inline bool isUnsigned() const noexcept
+		template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, simba_key>>>
+		friend bool operator<(const T& lhs, const simba_key& rhs) noexcept
 		{
-			return this->simbaTypeFlag == simba_type_flag_unsigned;
+			return std::string_view{ lhs } < std::string_view{ rhs.pooled->str };
 		}
 
-		// only relevant for object/map and array.
-		std::uint32_t size() const noexcept
-		{
-			if (this->simbaType == simba_type_object) {
-				return this->objectValue->size();
-			}
-			else if (this->simbaType == simba_type_array) {
-				return this->arrayValue->size();
-			}
+	private:
+		simba_key_table::entry* pooled;
+	};
 
-			return 0u;
-		}
+	// Sorted contiguous map, a cache friendly replacement for std::map used for objects
+	// when SIMBA_FLAT_OBJECT is defined. Keys are kept in order so iteration (and therefore
+	// serialization) order is the same as with std::map, lookups are a binary search over
+	// a single allocation and appending keys in ascending order (as the deserializer does) is O(1).
+	// Note that unlike std::map, inserting or erasing invalidates iterators and references.
+	template<typename Key, typename T, typename Compare, typename Allocator>
+	class simba_flat_map
+	{
+	public:
+		using key_type = Key;
+		using mapped_type = T;
+		using value_type = std::pair<Key, T>;
+		using key_compare = Compare;
+		using allocator_type = Allocator;
+		using container_type = std::vector<value_type, Allocator>;
+		using size_type = typename container_type::size_type;
+		using iterator = typename container_type::iterator;
+		using const_iterator = typename container_type::const_iterator;
+
+	public:
+		simba_flat_map() = default;
+
+		explicit simba_flat_map(const allocator_type& allocator)
+			: values(allocator)
+		{}
 
-		// only relevant for string types.
-		std::uint32_t length() const noexcept
-		{
-			if (this->simbaType == simba_type_string8) {
-				return this->string->length();
-			}
-			else if (this->simbaType == simba_type_string16) {
-				return this->u16string->length();
-			}
-			else if (this->simbaType == simba_type_string32) {
-				return this->u32string->length();
-			}
-			else if (this->simbaType == simba_type_string_w) {
-				return this->wstring->length();
-			}
+		simba_flat_map(const simba_flat_map& other, const allocator_type& allocator)
+			: values(other.values, allocator)
+		{}
 
-			return 0u;
+		simba_flat_map(simba_flat_map&& other, const allocator_type& allocator)
+			: values(std::move(other.values), allocator)
+		{}
+
+		template<typename InputIt>
+		simba_flat_map(InputIt first, InputIt last, const allocator_type& allocator = allocator_type())
+			: values(allocator)
+		{
+			this->insert(first, last);
 		}
 
-		simba_array_type& getArray()
+		simba_flat_map(std::initializer_list<value_type> values, const allocator_type& allocator = allocator_type())
+			: simba_flat_map(values.begin(), values.end(), allocator)
+		{}
+
+		simba_flat_map(const simba_flat_map&) = default;
+		simba_flat_map(simba_flat_map&&) = default;
+		simba_flat_map& operator=(const simba_flat_map&) = default;
+		simba_flat_map& operator=(simba_flat_map&&) = default;
+
+		allocator_type get_allocator() const noexcept
 		{
-			return this->get<simba_array_type>();
+			return this->values.get_allocator();
 		}
 
-		simba_object_type& getObject()
+	public:
+		iterator begin() noexcept { return this->values.begin(); }
+		iterator end() noexcept { return this->values.end(); }
+		const_iterator begin() const noexcept { return this->values.begin(); }
+		const_iterator end() const noexcept { return this->values.end(); }
+		const_iterator cbegin() const noexcept { return this->values.cbegin(); }
+		const_iterator cend() const noexcept { return this->values.cend(); }
+
+		size_type size() const noexcept { return this->values.size(); }
+		bool empty() const noexcept { return this->values.empty(); }
+		void clear() noexcept { this->values.clear(); }
+		void reserve(size_type count) { this->values.reserve(count); }
+
+		template<typename K>
+		iterator find(const K& key)
 		{
-			return this->get<simba_object_type>();
+			auto it = this->lowerBound(key);
+			return it != this->values.end() && !this->compare(key, it->first) ? it : this->values.end();
 		}
 
-		const simba_array_type& getArray() const
+		template<typename K>
+		const_iterator find(const K& key) const
 		{
-			return this->get<simba_array_type>();
+			return const_cast<simba_flat_map*>(this)->find(key);
 		}
 
-		const simba_object_type& getObject() const
+		template<typename K>
+		size_type count(const K& key) const
 		{
-			return this->get<simba_object_type>();
+			return this->find(key) != this->end() ? 1u : 0u;
 		}
 
-#pragma region
+		T& operator[](const Key& key)
+		{
+			return this->try_emplace(key).first->second;
+		}
 
-		template<typename T>
-		const T& get() const
+		T& operator[](Key&& key)
 		{
-			static_assert("No possible conversion for T");
+			return this->try_emplace(std::move(key)).first->second;
 		}
 
-		template<>
-		const std::int8_t& get<>() const
+		T& at(const Key& key)
 		{
-			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int8_t when simba value isn't a int8_t (use cast instead).");
+			auto it = this->find(key);
+
+			if (it == this->end()) {
+				throw std::out_of_range("simba_flat_map::at key not found");
 			}
 
-			return this->simpleValue->int8;
+			return it->second;
 		}
 
-		template<>
-		const std::int16_t& get<>() const
+		const T& at(const Key& key) const
 		{
-			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int16_t when simba value isn't a int16_t (use cast instead).");
-			}
-
-			return this->simpleValue->int16;
+			return const_cast<simba_flat_map*>(this)->at(key);
 		}
 
-		template<>
-		const std::int32_t& get<>() const
+		template<typename K, typename ...Args>
+		std::pair<iterator, bool> try_emplace(K&& key, Args&& ...args)
 		{
-			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int32 when simba value isn't a int32 (use cast instead).");
+			auto it = this->insertPosition(key);
+
+			if (it != this->values.end() && !this->compare(key, it->first)) {
+				return { it, false };
 			}
 
-			return this->simpleValue->int32;
+			it = this->values.emplace(it, std::piecewise_construct,
+				std::forward_as_tuple(std::forward<K>(key)),
+				std::forward_as_tuple(std::forward<Args>(args)...));
+			return { it, true };
 		}
 
-		template<>
-		const std::int64_t& get<>() const
+		template<typename K, typename M>
+		std::pair<iterator, bool> insert_or_assign(K&& key, M&& value)
 		{
-			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int64_t when simba value isn't a int64_t (use cast instead).");
+			auto result = this->try_emplace(std::forward<K>(key), std::forward<M>(value));
+
+			if (!result.second) {
+				result.first->second = std::forward<M>(value);
 			}
 
-			return this->simpleValue->int64;
+			return result;
 		}
 
-		template<>
-		const std::uint8_t& get<>() const
+		std::pair<iterator, bool> insert(value_type value)
 		{
-			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint8_t when simba value isn't a uint8_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint8;
+			return this->try_emplace(std::move(value.first), std::move(value.second));
 		}
 
-		template<>
-		const std::uint16_t& get<>() const
+		template<typename InputIt>
+		void insert(InputIt first, InputIt last)
 		{
-			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint16_t when simba value isn't a uint16_t (use cast instead).");
+			for (; first != last; ++first) {
+				this->try_emplace(first->first, first->second);
 			}
-
-			return this->simpleValue->uint16;
 		}
 
-		template<>
-		const std::uint32_t& get<>() const
+		template<typename K, typename ...Args>
+		std::pair<iterator, bool> emplace(K&& key, Args&& ...args)
 		{
-			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint32_t when simba value isn't a uint32_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint32;
+			return this->try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
 		}
 
-		template<>
-		const std::uint64_t& get<>() const
+		iterator erase(const_iterator pos)
 		{
-			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint64_t when simba value isn't a uint64_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint64;
+			return this->values.erase(pos);
 		}
 
-		template<>
-		const float& get<>() const
+		template<typename K>
+		size_type erase(const K& key)
 		{
-			if (this->simbaType != simba_type_float) {
-				throw std::exception("Attempted to retrieve a float when simba value isn't a float (use cast instead)");
-			}
-
-			return this->simpleValue->floatVal;
-		}
+			auto it = this->find(key);
 
-		template<>
-		const double& get<>() const
-		{
-			if (this->simbaType != simba_type_double) {
-				throw std::exception("Attempted to retrieve a double when simba value isn't a double (use cast instead)");
+			if (it == this->end()) {
+				return 0u;
 			}
 
-			return this->simpleValue->doubleVal;
+			this->values.erase(it);
+			return 1u;
 		}
 
-		template<>
-		const simba_object_type& get<>() const
+		bool operator==(const simba_flat_map& other) const
 		{
-			if (this->simbaType != simba_type_object) {
-				throw std::exception("Attempted to retrieve an object when simba value isn't an object");
-			}
-
-			return *this->objectValue;
+			return this->values == other.values;
 		}
 
-		template<>
-		const simba_array_type& get<>() const
+		bool operator!=(const simba_flat_map& other) const
 		{
-			if (this->simbaType != simba_type_array) {
-				throw std::exception("Attempted to retrieve an array when simba value isn't an array");
-			}
-
-			return *this->arrayValue;
+			return !(*this == other);
 		}
 
-		template<>
-		const std::string& get<>() const
+	private:
+		template<typename K>
+		iterator lowerBound(const K& key)
 		{
-			if (this->simbaType != simba_type_string8) {
-				throw std::exception("Attempted to retrieve a string when simba value isn't a string");
-			}
-
-			return *this->string;
+			return std::lower_bound(this->values.begin(), this->values.end(), key,
+				[this](const value_type& value, const K& k) { return this->compare(value.first, k); });
 		}
 
-		template<>
-		const std::u16string& get<>() const
+		// same as lowerBound but checks the back first, keys arriving in order are appended in O(1)
+		template<typename K>
+		iterator insertPosition(const K& key)
 		{
-			if (this->simbaType != simba_type_string16) {
-				throw std::exception("Attempted to retrieve a u16string when simba value isn't a u16string");
+			if (this->values.empty() || this->compare(this->values.back().first, key)) {
+				return this->values.end();
 			}
 
-			return *this->u16string;
+			return this->lowerBound(key);
 		}
 
-		template<>
-		const std::u32string& get<>() const
-		{
-			if (this->simbaType != simba_type_string32) {
-				throw std::exception("Attempted to retrieve a u32string when simba value isn't a u32string");
-			}
+	private:
+		container_type values;
+		Compare compare;
+	};
 
-			return *this->u32string;
-		}
+	// heap payload of arrays and objects, reference counted so that subtrees can be shared between values.
+	// A node with more than one reference is immutable, mutable access clones it first (see simba_value::share).
+	template<typename Container>
+	struct details::simba_node
+	{
+		template<typename ...Args>
+		explicit simba_node(Args&& ...args)
+			: container(std::forward<Args>(args)...)
+		{}
 
-		template<>
-		const std::wstring& get<>() const
+		bool isShared() const noexcept
 		{
-			if (this->simbaType != simba_type_string_w) {
-				throw std::exception("Attempted to retrieve a wstring when simba value isn't a wstring");
-			}
-
-			return *this->wstring;
+			return this->refs.load(std::memory_order_acquire) > 1u;
 		}
 
+		std::atomic<std::uint32_t> refs{ 1u };
+		// serialized size of this container, 0 when unknown (a container is never smaller than its header).
+		// Only filled in while the node is shared and can't change, reset whenever mutable access is handed out.
+		mutable std::atomic<std::uint64_t> serializedSize{ 0u };
+		Container container;
+	};
+
+	class simba_value
+	{
+	public: // public types and func prototypes
+		// containers use polymorphic allocators so a whole tree can live in a simba_document arena,
+		// by default they allocate from std::pmr::get_default_resource() (new/delete).
+#ifdef SIMBA_FLAT_OBJECT
+		using simba_object_type = simba_flat_map<simba_key, simba_value, std::less<>,
+			std::pmr::polymorphic_allocator<std::pair<simba_key, simba_value>>>;
+#else
+		using simba_object_type = std::pmr::map<simba_key, simba_value, std::less<>>;
+#endif
+		using simba_map_type = simba_object_type;
+		using simba_array_type = std::pmr::vector<simba_value>;
 		template<typename T>
-		T& get()
-		{
-			static_assert("No possible conversion for T");
-		}
+		using simba_typed_array_type = std::pmr::vector<T>;
 
-		template<>
-		std::int8_t& get<>()
-		{
-			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int8_t when simba value isn't a int8_t (use cast instead).");
-			}
+		union simba_simple_type {
+			std::int8_t int8;
+			std::uint8_t uint8;
+			std::int16_t int16;
+			std::uint16_t uint16;
+			std::int32_t int32;
+			std::uint32_t uint32;
+			std::int64_t int64;
+			std::uint64_t uint64;
+			float floatVal;
+			double doubleVal;
+		};
 
-			return this->simpleValue->int8;
+	public: // Constructors
+		simba_value()
+		{}
+		simba_value(std::nullptr_t)
+			: simba_value()
+		{}
+		simba_value(const simba_value& other)
+		{
+			*this = other;
 		}
-
-		template<>
-		std::int16_t& get<>()
+		simba_value(simba_value&& other) noexcept
 		{
-			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int16_t when simba value isn't a int16_t (use cast instead).");
-			}
-
-			return this->simpleValue->int16;
+			*this = std::move(other);
 		}
-
-		template<>
-		std::int32_t& get<>()
+		simba_value(const std::int8_t& int8)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int32 when simba value isn't a int32 (use cast instead).");
-			}
-
-			return this->simpleValue->int32;
+			*this = int8;
 		}
-
-		template<>
-		std::int64_t& get<>()
+		simba_value(const std::uint8_t& uint8)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_signed) {
-				throw std::exception("Attempted to retrieve int64_t when simba value isn't a int64_t (use cast instead).");
-			}
-
-			return this->simpleValue->int64;
+			*this = uint8;
 		}
-
-		template<>
-		std::uint8_t& get<>()
+		simba_value(const std::int16_t& int16)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint8_t when simba value isn't a uint8_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint8;
+			*this = int16;
 		}
-
-		template<>
-		std::uint16_t& get<>()
+		simba_value(const std::uint16_t& uint16)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint16_t when simba value isn't a uint16_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint16;
+			*this = uint16;
 		}
-
-		template<>
-		std::uint32_t& get<>()
+		simba_value(const std::int32_t& int32)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint32_t when simba value isn't a uint32_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint32;
+			*this = int32;
 		}
-
-		template<>
-		std::uint64_t& get<>()
+		simba_value(const std::uint32_t& uint32)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_unsigned) {
-				throw std::exception("Attempted to retrieve uint64_t when simba value isn't a uint64_t (use cast instead).");
-			}
-
-			return this->simpleValue->uint64;
+			*this = uint32;
 		}
-
-		template<>
-		float& get<>()
+		simba_value(const std::int64_t& int64)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_float) {
-				throw std::exception("Attempted to retrieve a float when simba value isn't a float (use cast instead)");
-			}
-
-			return this->simpleValue->floatVal;
+			*this = int64;
 		}
-
-		template<>
-		double& get<>()
+		simba_value(const std::uint64_t& uint64)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_double) {
-				throw std::exception("Attempted to retrieve a double when simba value isn't a double (use cast instead)");
-			}
-
-			return this->simpleValue->doubleVal;
+			*this = uint64;
 		}
-
-		template<>
-		simba_object_type& get<>()
+		simba_value(const float& floatVal)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_object) {
-				throw std::exception("Attempted to retrieve an object when simba value isn't an object");
-			}
-
-			return *this->objectValue;
+			*this = floatVal;
 		}
-
-		template<>
-		simba_array_type& get<>()
+		simba_value(const double& doubleVal)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_array) {
-				throw std::exception("Attempted to retrieve an array when simba value isn't an array");
-			}
-
-			return *this->arrayValue;
+			*this = doubleVal;
 		}
-
-		template<>
-		std::string& get<>()
+		simba_value(std::string string)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_string8) {
-				throw std::exception("Attempted to retrieve a string when simba value isn't a string");
-			}
-
-			return *this->string;
+			*this = std::move(string);
 		}
-
-		template<>
-		std::u16string& get<>()
+		simba_value(std::wstring wstring)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_string16) {
-				throw std::exception("Attempted to retrieve a u16string when simba value isn't a u16string");
-			}
-
-			return *this->u16string;
+			*this = std::move(wstring);
 		}
-
-		template<>
-		std::u32string& get<>()
+		simba_value(std::u16string u16string)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_string32) {
-				throw std::exception("Attempted to retrieve a u32string when simba value isn't a u32string");
-			}
-
-			return *this->u32string;
+			*this = std::move(u16string);
 		}
-
-		template<>
-		std::wstring& get<>()
+		simba_value(std::u32string u32string)
+			: simba_value()
 		{
-			if (this->simbaType != simba_type_string_w) {
-				throw std::exception("Attempted to retrieve a wstring when simba value isn't a wstring");
-			}
+			*this = std::move(u32string);
+		}
+		simba_value(simba_array_type arrayValue)
+			: simba_value()
+		{
+			*this = std::move(arrayValue);
+		}
+		simba_value(const std::vector<simba_value>& arrayValue)
+			: simba_value()
+		{
+			*this = simba_array_type(arrayValue.begin(), arrayValue.end());
+		}
+		simba_value(std::initializer_list<simba_value> arrayValue)
+			: simba_value()
+		{
+			*this = simba_array_type(arrayValue);
+		}
+		simba_value(simba_object_type objectValue)
+			: simba_value()
+		{
+			*this = std::move(objectValue);
+		}
+		template<typename T, typename = std::enable_if_t<details::typed_element<T>::value>>
+		simba_value(simba_typed_array_type<T> typedArray)
+			: simba_value()
+		{
+			*this = std::move(typedArray);
+		}
+		simba_value(const std::map<std::string, simba_value>& objectValue)
+			: simba_value()
+		{
+			*this = simba_object_type(objectValue.begin(), objectValue.end());
+		}
+		simba_value(std::initializer_list<std::pair<std::string, simba_value>> objectValue)
+			: simba_value()
+		{
+			*this = simba_object_type(objectValue.begin(), objectValue.end());
+		}
+		~simba_value()
+		{
+			this->destroyPtr();
+		}
+
+	public: // general functions
+		void abandon() // abandon ownership of any ptrs
+		{
+			this->simbaType = simba_type_null;
+			this->storage.simpleValue = {};
+		}
+
+		// type, one of simba_type_t
+		const std::uint8_t& getType() const noexcept
+		{
+			return this->simbaType;
+		}
+
+		// type flag, one of simba_type_flag_t
+		// only releveant on types that can be signed/unsigned
+		const std::uint8_t& getTypeFlag() const noexcept
+		{
+			return this->simbaTypeFlag;
+		}
+
+		inline bool isSigned() const noexcept
+		{
+			return this->simbaTypeFlag == simba_type_flag_signed;
+		}
+
+		inline bool isUnsigned() const noexcept
+		{
+			return this->simbaTypeFlag == simba_type_flag_unsigned;
+		}
 
-			return *this->wstring;
+		// element type of a typed array, one of simba_type_t (getTypeFlag() holds the elements' signedness)
+		const std::uint8_t& getElementType() const noexcept
+		{
+			return this->simbaElementType;
 		}
 
 		template<typename T>
-		T cast()
+		bool isTypedArrayOf() const noexcept
 		{
-			if constexpr (!std::is_arithmetic_v<T>) {
-				static_assert("Cannot cast to a non-arithmetic value");
+			return this->simbaType == simba_type_typed_array
+				&& this->simbaElementType == details::typed_element<T>::type
+				&& this->simbaTypeFlag == details::typed_element<T>::flag;
+		}
+
+		// only relevant for object/map, array and typed array.
+		std::uint32_t size() const noexcept
+		{
+			if (this->simbaType == simba_type_object) {
+				return this->storage.objectValue->container.size();
+			}
+			else if (this->simbaType == simba_type_array) {
+				return this->storage.arrayValue->container.size();
+			}
+			else if (this->simbaType == simba_type_typed_array) {
+				std::uint32_t result = 0u;
+				this->visitTypedNode([&result](auto* node) {
+					result = static_cast<std::uint32_t>(node->container.size());
+				});
+				return result;
 			}
 
-			switch (this->simbaType) {
-			case simba_type_int8:
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					return static_cast<T>(this->simpleValue->int8);
-				}
-				return static_cast<T>(this->simpleValue->uint8);
-				break;
-			case simba_type_int16:
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					return static_cast<T>(this->simpleValue->int16);
-				}
-				return static_cast<T>(this->simpleValue->uint16);
-				break;
-			case simba_type_int32:
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					return static_cast<T>(this->simpleValue->int32);
-				}
-				return static_cast<T>(this->simpleValue->uint32);
-				break;
-			case simba_type_int64:
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					return static_cast<T>(this->simpleValue->int64);
-				}
-				return static_cast<T>(this->simpleValue->uint64);
-				break;
-			case simba_type_float:
-				return static_cast<T>(this->simpleValue->floatVal);
-				break;
-			case simba_type_double:
-				return static_cast<T>(this->simpleValue->doubleVal);
-				break;
+			return 0u;
+		}
+
+		// only relevant for string types.
+		std::uint32_t length() const noexcept
+		{
+			if (this->simbaType == simba_type_string8) {
+				return this->storage.string.length();
+			}
+			else if (this->simbaType == simba_type_string16) {
+				return this->storage.u16string.length();
+			}
+			else if (this->simbaType == simba_type_string32) {
+				return this->storage.u32string.length();
+			}
+			else if (this->simbaType == simba_type_string_w) {
+				return this->storage.wstring.length();
 			}
 
-			throw std::exception("Unknown conversion to T");
+			return 0u;
 		}
 
-#pragma endregion getters
+		simba_array_type& getArray()
+		{
+			return this->get<simba_array_type>();
+		}
 
-		inline details::simba_serializer serialize() const;
-		inline details::simba_deserializer deserialize();
+		simba_object_type& getObject()
+		{
+			return this->get<simba_object_type>();
+		}
+
+		const simba_array_type& getArray() const
+		{
+			return this->get<simba_array_type>();
+		}
+
+		const simba_object_type& getObject() const
+		{
+			return this->get<simba_object_type>();
+		}
+
+		// T has to be the exact element type, see isTypedArrayOf()
+		template<typename T>
+		simba_typed_array_type<T>& getTypedArray()
+		{
+			if (!this->isTypedArrayOf<T>()) {
+				throw std::exception("Attempted to retrieve a typed array of a different element type");
+			}
+
+			this->detach();
+			return this->typedNode<T>()->container;
+		}
+
+		template<typename T>
+		const simba_typed_array_type<T>& getTypedArray() const
+		{
+			if (!this->isTypedArrayOf<T>()) {
+				throw std::exception("Attempted to retrieve a typed array of a different element type");
+			}
+
+			return this->typedNode<T>()->container;
+		}
 
-	public: // operators
 #pragma region
-		simba_value& operator=(simba_value&& other)
+
+		template<typename T>
+		const T& get() const
 		{
-			this->simbaType = other.simbaType;
-			this->simbaTypeFlag = other.simbaTypeFlag;
-			this->simpleValue = other.simpleValue;
-			this->objectValue = other.objectValue;
-			this->arrayValue = other.arrayValue;
-			this->string = other.string;
-			this->u16string = other.u16string;
-			this->u32string = other.u32string;
-			this->wstring = other.wstring;
+			static_assert("No possible conversion for T");
+		}
 
-			// Ensure other wont delete any ptrs
-			other.abandon();
+		template<>
+		const std::int8_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int8_t when simba value isn't a int8_t (use cast instead).");
+			}
 
-			return *this;
+			return this->storage.simpleValue.int8;
 		}
 
-		simba_value& operator=(const simba_value& other)
+		template<>
+		const std::int16_t& get<>() const
 		{
-			this->destroyPtr(); // Destroy current obj
+			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int16_t when simba value isn't a int16_t (use cast instead).");
+			}
 
-			this->simbaType = other.simbaType;
-			this->simbaTypeFlag = other.simbaTypeFlag;
+			return this->storage.simpleValue.int16;
+		}
 
-			switch (this->simbaType) {
-			case simba_type_null:
-				break;
-			case simba_type_int8:
-				this->simpleValue = new simba_value::simba_simple_type();
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					this->simpleValue->int8 = other.simpleValue->int8;
-				}
-				else {
-					this->simpleValue->uint8 = other.simpleValue->uint8;
-				}
-				break;
-			case simba_type_int16:
-				this->simpleValue = new simba_value::simba_simple_type();
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					this->simpleValue->int16 = other.simpleValue->int16;
-				}
-				else {
-					this->simpleValue->uint16 = other.simpleValue->uint16;
-				}
-				break;
-			case simba_type_int32:
-				this->simpleValue = new simba_value::simba_simple_type();
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					this->simpleValue->int32 = other.simpleValue->int32;
-				}
-				else {
-					this->simpleValue->uint32 = other.simpleValue->uint32;
-				}
-				break;
-			case simba_type_int64:
-				this->simpleValue = new simba_value::simba_simple_type();
-				if (this->simbaTypeFlag == simba_type_flag_signed) {
-					this->simpleValue->int64 = other.simpleValue->int64;
-				}
-				else {
-					this->simpleValue->uint64 = other.simpleValue->uint64;
-				}
-				break;
-			case simba_type_float:
-				this->simpleValue = new simba_value::simba_simple_type();
-				this->simpleValue->floatVal = other.simpleValue->floatVal;
-				break;
-			case simba_type_double:
-				this->simpleValue = new simba_value::simba_simple_type();
-				this->simpleValue->doubleVal = other.simpleValue->doubleVal;
-				break;
-			case simba_type_object:
-				//case simba_type_map:
-				this->objectValue = new simba_value::simba_object_type(*other.objectValue);
-				//this->objectValue->insert(other.objectValue->cbegin(), other.objectValue->cend());
+		template<>
+		const std::int32_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int32 when simba value isn't a int32 (use cast instead).");
+			}
 
-				//std::copy(other.objectValue->begin(), other.objectValue->end(), this->objectValue->begin());
+			return this->storage.simpleValue.int32;
+		}
 
-				/*
-				for (auto it = other.objectValue->cbegin(), end = other.objectValue->cend();
-					it != end;
-					++it) {
-					this->objectValue->emplace(it->first, it->second);
-				}*/
-				break;
-			case simba_type_array:
-				this->arrayValue = new simba_value::simba_array_type(*other.arrayValue);
-				/*
-				for (auto it = other.arrayValue->cbegin(), end = other.arrayValue->cend();
-					it != end;
-					++it) {
-					this->arrayValue->emplace_back(*it);
-				}*/
-				break;
-			case simba_type_string8:
-				this->string = new std::string(*other.string);
-				break;
-			case simba_type_string16:
-				this->u16string = new std::u16string(*other.u16string);
-				break;
-			case simba_type_string32:
-				this->u32string = new std::u32string(*other.u32string);
-				break;
-			case simba_type_string_w:
-				this->wstring = new std::wstring(*other.wstring);
-				break;
+		template<>
+		const std::int64_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int64_t when simba value isn't a int64_t (use cast instead).");
 			}
 
-			return *this;
-		}
+			return this->storage.simpleValue.int64;
+		}
+
+		template<>
+		const std::uint8_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint8_t when simba value isn't a uint8_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint8;
+		}
+
+		template<>
+		const std::uint16_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint16_t when simba value isn't a uint16_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint16;
+		}
+
+		template<>
+		const std::uint32_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint32_t when simba value isn't a uint32_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint32;
+		}
+
+		template<>
+		const std::uint64_t& get<>() const
+		{
+			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint64_t when simba value isn't a uint64_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint64;
+		}
+
+		template<>
+		const float& get<>() const
+		{
+			if (this->simbaType != simba_type_float) {
+				throw std::exception("Attempted to retrieve a float when simba value isn't a float (use cast instead)");
+			}
+
+			return this->storage.simpleValue.floatVal;
+		}
+
+		template<>
+		const double& get<>() const
+		{
+			if (this->simbaType != simba_type_double) {
+				throw std::exception("Attempted to retrieve a double when simba value isn't a double (use cast instead)");
+			}
+
+			return this->storage.simpleValue.doubleVal;
+		}
+
+		template<>
+		const simba_object_type& get<>() const
+		{
+			if (this->simbaType != simba_type_object) {
+				throw std::exception("Attempted to retrieve an object when simba value isn't an object");
+			}
+
+			return this->storage.objectValue->container;
+		}
+
+		template<>
+		const simba_array_type& get<>() const
+		{
+			if (this->simbaType != simba_type_array) {
+				throw std::exception("Attempted to retrieve an array when simba value isn't an array");
+			}
+
+			return this->storage.arrayValue->container;
+		}
+
+		template<>
+		const std::string& get<>() const
+		{
+			if (this->simbaType != simba_type_string8) {
+				throw std::exception("Attempted to retrieve a string when simba value isn't a string");
+			}
+
+			return this->storage.string;
+		}
+
+		template<>
+		const std::u16string& get<>() const
+		{
+			if (this->simbaType != simba_type_string16) {
+				throw std::exception("Attempted to retrieve a u16string when simba value isn't a u16string");
+			}
+
+			return this->storage.u16string;
+		}
+
+		template<>
+		const std::u32string& get<>() const
+		{
+			if (this->simbaType != simba_type_string32) {
+				throw std::exception("Attempted to retrieve a u32string when simba value isn't a u32string");
+			}
+
+			return this->storage.u32string;
+		}
+
+		template<>
+		const std::wstring& get<>() const
+		{
+			if (this->simbaType != simba_type_string_w) {
+				throw std::exception("Attempted to retrieve a wstring when simba value isn't a wstring");
+			}
+
+			return this->storage.wstring;
+		}
+
+		template<typename T>
+		T& get()
+		{
+			static_assert("No possible conversion for T");
+		}
+
+		template<>
+		std::int8_t& get<>()
+		{
+			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int8_t when simba value isn't a int8_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.int8;
+		}
+
+		template<>
+		std::int16_t& get<>()
+		{
+			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int16_t when simba value isn't a int16_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.int16;
+		}
+
+		template<>
+		std::int32_t& get<>()
+		{
+			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int32 when simba value isn't a int32 (use cast instead).");
+			}
+
+			return this->storage.simpleValue.int32;
+		}
+
+		template<>
+		std::int64_t& get<>()
+		{
+			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_signed) {
+				throw std::exception("Attempted to retrieve int64_t when simba value isn't a int64_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.int64;
+		}
+
+		template<>
+		std::uint8_t& get<>()
+		{
+			if (this->simbaType != simba_type_int8 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint8_t when simba value isn't a uint8_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint8;
+		}
+
+		template<>
+		std::uint16_t& get<>()
+		{
+			if (this->simbaType != simba_type_int16 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint16_t when simba value isn't a uint16_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint16;
+		}
+
+		template<>
+		std::uint32_t& get<>()
+		{
+			if (this->simbaType != simba_type_int32 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint32_t when simba value isn't a uint32_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint32;
+		}
+
+		template<>
+		std::uint64_t& get<>()
+		{
+			if (this->simbaType != simba_type_int64 || this->simbaTypeFlag != simba_type_flag_unsigned) {
+				throw std::exception("Attempted to retrieve uint64_t when simba value isn't a uint64_t (use cast instead).");
+			}
+
+			return this->storage.simpleValue.uint64;
+		}
+
+		template<>
+		float& get<>()
+		{
+			if (this->simbaType != simba_type_float) {
+				throw std::exception("Attempted to retrieve a float when simba value isn't a float (use cast instead)");
+			}
+
+			return this->storage.simpleValue.floatVal;
+		}
+
+		template<>
+		double& get<>()
+		{
+			if (this->simbaType != simba_type_double) {
+				throw std::exception("Attempted to retrieve a double when simba value isn't a double (use cast instead)");
+			}
+
+			return this->storage.simpleValue.doubleVal;
+		}
+
+		template<>
+		simba_object_type& get<>()
+		{
+			if (this->simbaType != simba_type_object) {
+				throw std::exception("Attempted to retrieve an object when simba value isn't an object");
+			}
+
+			this->detach();
+			return this->storage.objectValue->container;
+		}
+
+		template<>
+		simba_array_type& get<>()
+		{
+			if (this->simbaType != simba_type_array) {
+				throw std::exception("Attempted to retrieve an array when simba value isn't an array");
+			}
+
+			this->detach();
+			return this->storage.arrayValue->container;
+		}
+
+		template<>
+		std::string& get<>()
+		{
+			if (this->simbaType != simba_type_string8) {
+				throw std::exception("Attempted to retrieve a string when simba value isn't a string");
+			}
+
+			return this->storage.string;
+		}
+
+		template<>
+		std::u16string& get<>()
+		{
+			if (this->simbaType != simba_type_string16) {
+				throw std::exception("Attempted to retrieve a u16string when simba value isn't a u16string");
+			}
+
+			return this->storage.u16string;
+		}
+
+		template<>
+		std::u32string& get<>()
+		{
+			if (this->simbaType != simba_type_string32) {
+				throw std::exception("Attempted to retrieve a u32string when simba value isn't a u32string");
+			}
+
+			return this->storage.u32string;
+		}
+
+		template<>
+		std::wstring& get<>()
+		{
+			if (this->simbaType != simba_type_string_w) {
+				throw std::exception("Attempted to retrieve a wstring when simba value isn't a wstring");
+			}
+
+			return this->storage.wstring;
+		}
+
+		template<typename T>
+		T cast() const
+		{
+			if constexpr (!std::is_arithmetic_v<T>) {
+				static_assert("Cannot cast to a non-arithmetic value");
+			}
+
+			switch (this->simbaType) {
+			case simba_type_int8:
+				if (this->simbaTypeFlag == simba_type_flag_signed) {
+					return static_cast<T>(this->storage.simpleValue.int8);
+				}
+				return static_cast<T>(this->storage.simpleValue.uint8);
+				break;
+			case simba_type_int16:
+				if (this->simbaTypeFlag == simba_type_flag_signed) {
+					return static_cast<T>(this->storage.simpleValue.int16);
+				}
+				return static_cast<T>(this->storage.simpleValue.uint16);
+				break;
+			case simba_type_int32:
+				if (this->simbaTypeFlag == simba_type_flag_signed) {
+					return static_cast<T>(this->storage.simpleValue.int32);
+				}
+				return static_cast<T>(this->storage.simpleValue.uint32);
+				break;
+			case simba_type_int64:
+				if (this->simbaTypeFlag == simba_type_flag_signed) {
+					return static_cast<T>(this->storage.simpleValue.int64);
+				}
+				return static_cast<T>(this->storage.simpleValue.uint64);
+				break;
+			case simba_type_float:
+				return static_cast<T>(this->storage.simpleValue.floatVal);
+				break;
+			case simba_type_double:
+				return static_cast<T>(this->storage.simpleValue.doubleVal);
+				break;
+			}
+
+			throw std::exception("Unknown conversion to T");
+		}
+
+#pragma endregion getters
+
+		// O(1) copy that shares arrays and objects with this value instead of copying them.
+		// Shared containers become immutable, mutable access through get<>(), getArray(), getObject()
+		// or operator[] on any of the sharing values clones just the containers on the path to the change.
+		// References obtained before sharing must not be used to mutate afterwards, and values sharing
+		// a subtree of a simba_document must not outlive the document.
+		simba_value share() const
+		{
+			simba_value shared;
+
+			switch (this->simbaType) {
+			case simba_type_object:
+				shared.simbaType = simba_type_object;
+				shared.storage.objectValue = acquireNode(this->storage.objectValue);
+				break;
+			case simba_type_array:
+				shared.simbaType = simba_type_array;
+				shared.storage.arrayValue = acquireNode(this->storage.arrayValue);
+				break;
+			case simba_type_typed_array:
+				shared.simbaType = simba_type_typed_array;
+				shared.simbaTypeFlag = this->simbaTypeFlag;
+				shared.simbaElementType = this->simbaElementType;
+				this->visitTypedNode([&shared](auto* node) {
+					shared.storage.typedArrayValue = acquireNode(node);
+				});
+				break;
+			default:
+				shared = *this; // nothing to share
+				break;
+			}
+
+			return shared;
+		}
+
+		// construct a new element in place at the end of this array
+		template<typename ...Args>
+		simba_value& emplaceBack(Args&& ...args)
+		{
+			return this->getArray().emplace_back(std::forward<Args>(args)...);
+		}
+
+		// construct the value of key in place in this object, an existing value is replaced
+		template<typename ...Args>
+		simba_value& emplace(simba_key key, Args&& ...args)
+		{
+			auto& object = this->getObject();
+			auto result = object.try_emplace(key, std::forward<Args>(args)...);
+
+			if (!result.second) {
+				result.first->second = simba_value(std::forward<Args>(args)...);
+			}
+
+			return result.first->second;
+		}
+
+		// reserve room for count elements, only relevant for arrays (and flat objects)
+		void reserve(std::uint32_t count)
+		{
+			if (this->simbaType == simba_type_array) {
+				this->getArray().reserve(count);
+			}
+			else if (this->simbaType == simba_type_object) {
+				simba::details::reserve(this->getObject(), count);
+			}
+		}
+
+		inline details::simba_serializer serialize() const;
+		inline details::simba_deserializer deserialize();
+
+		// exact number of bytes serialize() will produce
+		inline std::size_t serializedSize() const;
+
+	public: // operators
+#pragma region
+		simba_value& operator=(simba_value&& other) noexcept
+		{
+			if (this == &other) {
+				return *this;
+			}
+
+			this->destroyPtr(); // Destroy current obj
+
+			this->simbaType = other.simbaType;
+			this->simbaTypeFlag = other.simbaTypeFlag;
+			this->simbaElementType = other.simbaElementType;
+
+			switch (this->simbaType) {
+			case simba_type_string8:
+				new (&this->storage.string) std::string(std::move(other.storage.string));
+				other.destroyPtr();
+				break;
+			case simba_type_string16:
+				new (&this->storage.u16string) std::u16string(std::move(other.storage.u16string));
+				other.destroyPtr();
+				break;
+			case simba_type_string32:
+				new (&this->storage.u32string) std::u32string(std::move(other.storage.u32string));
+				other.destroyPtr();
+				break;
+			case simba_type_string_w:
+				new (&this->storage.wstring) std::wstring(std::move(other.storage.wstring));
+				other.destroyPtr();
+				break;
+			case simba_type_object:
+				this->storage.objectValue = other.storage.objectValue;
+				other.abandon(); // Ensure other wont delete any ptrs
+				break;
+			case simba_type_array:
+				this->storage.arrayValue = other.storage.arrayValue;
+				other.abandon(); // Ensure other wont delete any ptrs
+				break;
+			case simba_type_typed_array:
+				this->storage.typedArrayValue = other.storage.typedArrayValue;
+				other.abandon(); // Ensure other wont delete any ptrs
+				break;
+			default:
+				this->storage.simpleValue = other.storage.simpleValue;
+				other.abandon();
+				break;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(const simba_value& other)
+		{
+			if (this == &other) {
+				return *this;
+			}
+
+			this->destroyPtr(); // Destroy current obj
+
+			this->simbaType = other.simbaType;
+			this->simbaTypeFlag = other.simbaTypeFlag;
+			this->simbaElementType = other.simbaElementType;
+
+			switch (this->simbaType) {
+			case simba_type_null:
+				break;
+			case simba_type_int8:
+			case simba_type_int16:
+			case simba_type_int32:
+			case simba_type_int64:
+			case simba_type_float:
+			case simba_type_double:
+				// simple values live inline, a plain copy is enough
+				this->storage.simpleValue = other.storage.simpleValue;
+				break;
+			case simba_type_object:
+				//case simba_type_map:
+				if (shareable(other.storage.objectValue)) {
+					// already immutable, sharing it once more is safe
+					this->storage.objectValue = acquireNode(other.storage.objectValue);
+				}
+				else {
+					this->storage.objectValue = createNode<simba_object_type>(std::pmr::get_default_resource(), other.storage.objectValue->container);
+				}
+				break;
+			case simba_type_array:
+				if (shareable(other.storage.arrayValue)) {
+					this->storage.arrayValue = acquireNode(other.storage.arrayValue);
+				}
+				else {
+					this->storage.arrayValue = createNode<simba_array_type>(std::pmr::get_default_resource(), other.storage.arrayValue->container);
+				}
+				break;
+			case simba_type_typed_array:
+				other.visitTypedNode([this](auto* node) {
+					using container_t = std::remove_reference_t<decltype(node->container)>;
+
+					if (shareable(node)) {
+						this->storage.typedArrayValue = acquireNode(node);
+					}
+					else {
+						this->storage.typedArrayValue = createNode<container_t>(std::pmr::get_default_resource(), node->container);
+					}
+				});
+				break;
+			case simba_type_string8:
+				new (&this->storage.string) std::string(other.storage.string);
+				break;
+			case simba_type_string16:
+				new (&this->storage.u16string) std::u16string(other.storage.u16string);
+				break;
+			case simba_type_string32:
+				new (&this->storage.u32string) std::u32string(other.storage.u32string);
+				break;
+			case simba_type_string_w:
+				new (&this->storage.wstring) std::wstring(other.storage.wstring);
+				break;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(const std::nullptr_t& nullValue)
+		{
+			this->destroyPtr();
+			return *this;
+		}
+
+		simba_value& operator=(const std::int8_t& int8)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int8;
+			this->simbaTypeFlag = simba_type_flag_signed;
+			this->storage.simpleValue.int8 = int8;
+			return *this;
+		}
+
+		simba_value& operator=(const std::uint8_t& uint8)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int8;
+			this->simbaTypeFlag = simba_type_flag_unsigned;
+			this->storage.simpleValue.uint8 = uint8;
+			return *this;
+		}
+
+		simba_value& operator=(const std::int16_t& int16)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int16;
+			this->simbaTypeFlag = simba_type_flag_signed;
+			this->storage.simpleValue.int16 = int16;
+			return *this;
+		}
+
+		simba_value& operator=(const std::uint16_t& uint16)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int16;
+			this->simbaTypeFlag = simba_type_flag_unsigned;
+			this->storage.simpleValue.uint16 = uint16;
+			return *this;
+		}
+
+		simba_value& operator=(const std::int32_t& int32)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int32;
+			this->simbaTypeFlag = simba_type_flag_signed;
+			this->storage.simpleValue.int32 = int32;
+			return *this;
+		}
+
+		simba_value& operator=(const std::uint32_t& uint32)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int32;
+			this->simbaTypeFlag = simba_type_flag_unsigned;
+			this->storage.simpleValue.uint32 = uint32;
+			return *this;
+		}
+
+		simba_value& operator=(const std::int64_t& int64)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int64;
+			this->simbaTypeFlag = simba_type_flag_signed;
+			this->storage.simpleValue.int64 = int64;
+			return *this;
+		}
+
+		simba_value& operator=(const std::uint64_t& uint64)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_int64;
+			this->simbaTypeFlag = simba_type_flag_unsigned;
+			this->storage.simpleValue.uint64 = uint64;
+			return *this;
+		}
+
+		simba_value& operator=(const float& floatVal)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_float;
+			this->storage.simpleValue.floatVal = floatVal;
+			return *this;
+		}
+
+		simba_value& operator=(const double& doubleVal)
+		{
+			this->simpleAssign();
+
+			this->simbaType = simba_type_double;
+			this->storage.simpleValue.doubleVal = doubleVal;
+			return *this;
+		}
+
+		simba_value& operator=(const simba_object_type& object)
+		{
+			this->destroyPtr();
+
+			this->simbaType = simba_type_object;
+			this->storage.objectValue = createNode<simba_object_type>(std::pmr::get_default_resource(), object);
+			return *this;
+		}
+
+		simba_value& operator=(simba_object_type&& object)
+		{
+			this->destroyPtr();
+
+			this->simbaType = simba_type_object;
+			this->storage.objectValue = createNode<simba_object_type>(object.get_allocator().resource(), std::move(object));
+			return *this;
+		}
+
+		simba_value& operator=(const simba_array_type& array)
+		{
+			this->destroyPtr();
+
+			this->simbaType = simba_type_array;
+			this->storage.arrayValue = createNode<simba_array_type>(std::pmr::get_default_resource(), array);
+			return *this;
+		}
+
+		simba_value& operator=(simba_array_type&& array)
+		{
+			this->destroyPtr();
+
+			this->simbaType = simba_type_array;
+			this->storage.arrayValue = createNode<simba_array_type>(array.get_allocator().resource(), std::move(array));
+			return *this;
+		}
+
+		template<typename T, typename = std::enable_if_t<details::typed_element<T>::value>>
+		simba_value& operator=(simba_typed_array_type<T> typedArray)
+		{
+			this->destroyPtr();
+
+			this->simbaType = simba_type_typed_array;
+			this->simbaTypeFlag = details::typed_element<T>::flag;
+			this->simbaElementType = details::typed_element<T>::type;
+			this->storage.typedArrayValue = createNode<simba_typed_array_type<T>>(typedArray.get_allocator().resource(), std::move(typedArray));
+			return *this;
+		}
+
+		simba_value& operator=(const std::string& string)
+		{
+			if (this->simbaType == simba_type_string8) {
+				this->storage.string = string;
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.string) std::string(string);
+				this->simbaType = simba_type_string8;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(std::string&& string)
+		{
+			if (this->simbaType == simba_type_string8) {
+				this->storage.string = std::move(string);
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.string) std::string(std::move(string));
+				this->simbaType = simba_type_string8;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(const std::u16string& u16string)
+		{
+			if (this->simbaType == simba_type_string16) {
+				this->storage.u16string = u16string;
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.u16string) std::u16string(u16string);
+				this->simbaType = simba_type_string16;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(std::u16string&& u16string)
+		{
+			if (this->simbaType == simba_type_string16) {
+				this->storage.u16string = std::move(u16string);
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.u16string) std::u16string(std::move(u16string));
+				this->simbaType = simba_type_string16;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(const std::u32string& u32string)
+		{
+			if (this->simbaType == simba_type_string32) {
+				this->storage.u32string = u32string;
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.u32string) std::u32string(u32string);
+				this->simbaType = simba_type_string32;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(std::u32string&& u32string)
+		{
+			if (this->simbaType == simba_type_string32) {
+				this->storage.u32string = std::move(u32string);
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.u32string) std::u32string(std::move(u32string));
+				this->simbaType = simba_type_string32;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(const std::wstring& wstring)
+		{
+			if (this->simbaType == simba_type_string_w) {
+				this->storage.wstring = wstring;
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.wstring) std::wstring(wstring);
+				this->simbaType = simba_type_string_w;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator=(std::wstring&& wstring)
+		{
+			if (this->simbaType == simba_type_string_w) {
+				this->storage.wstring = std::move(wstring);
+			}
+			else {
+				this->destroyPtr();
+				new (&this->storage.wstring) std::wstring(std::move(wstring));
+				this->simbaType = simba_type_string_w;
+			}
+
+			return *this;
+		}
+
+		simba_value& operator[](const std::uint32_t& index)
+		{
+			if (this->simbaType != simba_type_array) {
+				throw std::exception("Cannot retrieve with integer index from non array type");
+			}
+
+			this->detach();
+
+			return this->storage.arrayValue->container.at(index);
+		}
+
+		const simba_value& operator[](const std::uint32_t& index) const
+		{
+			if (this->simbaType != simba_type_array) {
+				throw std::exception("Cannot retrieve with integer index from non array type");
+			}
+
+			return this->storage.arrayValue->container.at(index);
+		}
+
+		simba_value& operator[](std::string_view index)
+		{
+			if (this->simbaType != simba_type_object) {
+				throw std::exception("Cannot retrieve string index from non object type");
+			}
+
+			this->detach();
+
+			auto it = this->storage.objectValue->container.find(index);
+
+			if (it != this->storage.objectValue->container.end()) {
+				return it->second;
+			}
+
+			return this->storage.objectValue->container.emplace(simba_key(index), nullptr).first->second;
+		}
+
+		const simba_value& operator[](std::string_view index) const
+		{
+			if (this->simbaType != simba_type_object) {
+				throw std::exception("Cannot retrieve string index from non object type");
+			}
+
+			auto it = this->storage.objectValue->container.find(index);
+
+			if (it != this->storage.objectValue->container.end()) {
+				return it->second;
+			}
+
+			throw std::exception("Cannot create item with operator[] when in const scope");
+		}
+
+		bool operator==(const simba_value& other) const
+		{
+			// Basic type check
+			if (other.simbaType != this->simbaType) {
+				return false;
+			}
+
+			// signed/unsigned check
+			if (simba::details::hasTypeFlag(this->simbaType) && other.simbaTypeFlag != this->simbaTypeFlag) {
+				return false;
+			}
+
+			if (this->simbaType == simba_type_typed_array) {
+				if (other.simbaElementType != this->simbaElementType || other.simbaTypeFlag != this->simbaTypeFlag) {
+					return false;
+				}
+
+				bool equal = false;
+				this->visitTypedNode([&equal, &other](auto* node) {
+					using node_t = std::remove_pointer_t<decltype(node)>;
+					equal = node == other.storage.typedArrayValue
+						|| node->container == static_cast<const node_t*>(other.storage.typedArrayValue)->container;
+				});
+				return equal;
+			}
+
+			switch (this->simbaType) {
+			case simba_type_null:
+				return true; // both are null
+				break;
+
+			case simba_type_int8:
+				if (this->isSigned()) {
+					return this->storage.simpleValue.int8 == other.storage.simpleValue.int8;
+				}
+				return this->storage.simpleValue.uint8 == other.storage.simpleValue.uint8;
+				break;
+			case simba_type_int16:
+				if (this->isSigned()) {
+					return this->storage.simpleValue.int16 == other.storage.simpleValue.int16;
+				}
+				return this->storage.simpleValue.uint16 == other.storage.simpleValue.uint16;
+				break;
+			case simba_type_int32:
+				if (this->isSigned()) {
+					return this->storage.simpleValue.int32 == other.storage.simpleValue.int32;
+				}
+				return this->storage.simpleValue.uint32 == other.storage.simpleValue.uint32;
+				break;
+			case simba_type_int64:
+				if (this->isSigned()) {
+					return this->storage.simpleValue.int64 == other.storage.simpleValue.int64;
+				}
+				return this->storage.simpleValue.uint64 == other.storage.simpleValue.uint64;
+				break;
+			case simba_type_float:
+				return this->storage.simpleValue.floatVal == other.storage.simpleValue.floatVal;
+				break;
+			case simba_type_double:
+				return this->storage.simpleValue.doubleVal == other.storage.simpleValue.doubleVal;
+				break;
+			case simba_type_array:
+				if (this->storage.arrayValue == other.storage.arrayValue) {
+					return true; // shared
+				}
+
+				if (this->storage.arrayValue->container.size() != other.storage.arrayValue->container.size()) {
+					return false;
+				}
+
+				{ // compare all elements of the array
+					auto it1 = this->storage.arrayValue->container.cbegin(),
+						end1 = this->storage.arrayValue->container.cend(),
+						it2 = other.storage.arrayValue->container.cbegin(),
+						end2 = other.storage.arrayValue->container.cend();
+
+					for (; it1 != end1 && it2 != end2; ++it1, ++it2) {
+						if (*it1 != *it2) {
+							return false;
+						}
+					}
+
+					return true;
+				}
+				break;
+			case simba_type_object:
+				if (this->storage.objectValue == other.storage.objectValue) {
+					return true; // shared
+				}
+
+				if (this->storage.objectValue->container.size() != other.storage.objectValue->container.size()) {
+					return false;
+				}
+
+				{ // recursively check all key/value pairs
+					for (auto it = this->storage.objectValue->container.cbegin(), end = this->storage.objectValue->container.cend();
+						it != end; ++it) {
+						auto found = other.storage.objectValue->container.find(it->first);
+
+						if (found == other.storage.objectValue->container.end()) {
+							return false;
+						}
+
+						if (it->second != found->second) {
+							return false;
+						}
+					}
+
+					return true;
+				}
+				break;
+			case simba_type_string8:
+				return this->storage.string == other.storage.string;
+				break;
+			case simba_type_string16:
+				return this->storage.u16string == other.storage.u16string;
+				break;
+			case simba_type_string32:
+				return this->storage.u32string == other.storage.u32string;
+				break;
+			case simba_type_string_w:
+				return this->storage.wstring == other.storage.wstring;
+				break;
+			}
+
+
+			return false; // unknown types??
+		}
+
+		bool operator!=(const simba_value& other) const
+		{
+			return !(*this == other);
+		}
+#pragma endregion operators
+
+	private: // general private functions
+
+		// prepare for storing a simple value inline (only frees something if the current type owns a heap payload)
+		void simpleAssign()
+		{
+			if (!simba::details::isSimpleType(this->simbaType)) {
+				this->destroyPtr();
+			}
+		}
+
+		// container nodes are allocated from the same memory resource as their elements,
+		// which keeps trees built inside a simba_document and regular heap trees interchangeable.
+		template<typename Container, typename ...Args>
+		static details::simba_node<Container>* createNode(std::pmr::memory_resource* resource, Args&& ...args)
+		{
+			using node_t = details::simba_node<Container>;
+			void* memory = resource->allocate(sizeof(node_t), alignof(node_t));
+
+			try {
+				return new (memory) node_t(std::forward<Args>(args)..., typename Container::allocator_type(resource));
+			}
+			catch (...) {
+				resource->deallocate(memory, sizeof(node_t), alignof(node_t));
+				throw;
+			}
+		}
+
+		template<typename Container>
+		static details::simba_node<Container>* acquireNode(details::simba_node<Container>* node) noexcept
+		{
+			node->refs.fetch_add(1u, std::memory_order_relaxed);
+			return node;
+		}
+
+		// copies take another reference to a shared node only if it lives on the heap, one from a
+		// simba_document arena is copied so the copy stays valid after the document is cleared
+		template<typename Container>
+		static bool shareable(const details::simba_node<Container>* node) noexcept
+		{
+			return node->isShared() && node->container.get_allocator().resource() == std::pmr::get_default_resource();
+		}
+
+		template<typename Container>
+		static void releaseNode(details::simba_node<Container>* node)
+		{
+			if (node->refs.fetch_sub(1u, std::memory_order_acq_rel) != 1u) {
+				return; // still referenced by another value
+			}
+
+			using node_t = details::simba_node<Container>;
+			auto* resource = node->container.get_allocator().resource();
+			node->~node_t();
+			resource->deallocate(node, sizeof(node_t), alignof(node_t));
+		}
+
+		// called before handing out mutable access to an array/object, a shared container is
+		// replaced by a private copy whose children are still shared. This way a mutation deep
+		// inside a shared tree only copies the containers along the path leading to it.
+		void detach()
+		{
+			if (this->simbaType == simba_type_array && this->storage.arrayValue->isShared()) {
+				auto* shared = this->storage.arrayValue;
+				simba_array_type copy{ shared->container.get_allocator() };
+				copy.reserve(shared->container.size());
+
+				for (const auto& el : shared->container) {
+					copy.emplace_back(el.share());
+				}
+
+				this->storage.arrayValue = createNode<simba_array_type>(copy.get_allocator().resource(), std::move(copy));
+				releaseNode(shared);
+			}
+			else if (this->simbaType == simba_type_object && this->storage.objectValue->isShared()) {
+				auto* shared = this->storage.objectValue;
+				simba_object_type copy{ shared->container.get_allocator() };
+				simba::details::reserve(copy, shared->container.size());
+
+				for (const auto& el : shared->container) {
+					copy.emplace(el.first, el.second.share());
+				}
+
+				this->storage.objectValue = createNode<simba_object_type>(copy.get_allocator().resource(), std::move(copy));
+				releaseNode(shared);
+			}
+			else if (this->simbaType == simba_type_typed_array) {
+				this->visitTypedNode([this](auto* shared) {
+					using container_t = std::remove_reference_t<decltype(shared->container)>;
+
+					if (shared->isShared()) {
+						this->storage.typedArrayValue = createNode<container_t>(shared->container.get_allocator().resource(), shared->container);
+						releaseNode(shared);
+					}
+				});
+			}
+
+			// the caller is about to mutate, a cached size would go stale
+			if (this->simbaType == simba_type_array) {
+				this->storage.arrayValue->serializedSize.store(0u, std::memory_order_relaxed);
+			}
+			else if (this->simbaType == simba_type_object) {
+				this->storage.objectValue->serializedSize.store(0u, std::memory_order_relaxed);
+			}
+		}
+
+		// typed array nodes are stored type erased, simbaElementType and simbaTypeFlag decide the element type
+		template<typename T>
+		details::simba_node<simba_typed_array_type<T>>* typedNode() const noexcept
+		{
+			return static_cast<details::simba_node<simba_typed_array_type<T>>*>(this->storage.typedArrayValue);
+		}
+
+		// calls f with the typed node of this typed array
+		template<typename F>
+		void visitTypedNode(F&& f) const
+		{
+			simba::details::visitElementType(this->simbaElementType, this->simbaTypeFlag, [this, &f](auto element) {
+				f(this->typedNode<decltype(element)>());
+			});
+		}
+
+		void destroyPtr()
+		{
+			switch (this->simbaType) {
+			case simba_type_object:
+				releaseNode(this->storage.objectValue);
+				break;
+			case simba_type_array:
+				releaseNode(this->storage.arrayValue);
+				break;
+			case simba_type_typed_array:
+				this->visitTypedNode([](auto* node) {
+					releaseNode(node);
+				});
+				break;
+			case simba_type_string8:
+				this->storage.string.~basic_string();
+				break;
+			case simba_type_string16:
+				this->storage.u16string.~basic_string();
+				break;
+			case simba_type_string32:
+				this->storage.u32string.~basic_string();
+				break;
+			case simba_type_string_w:
+				this->storage.wstring.~basic_string();
+				break;
+			}
+
+			this->simbaType = simba_type_null;
+			this->storage.simpleValue = {};
+		}
+
+	private:
+		friend class details::simba_serializer;
+
+		// simple values and strings are stored inline, objects and arrays own a heap payload.
+		// simbaType decides which member is active, strings are constructed and destroyed manually.
+		// Keeping the strings inline lets their small-string buffer hold short strings without any allocation.
+		union simba_storage {
+			simba_storage() noexcept
+				: simpleValue{}
+			{}
+			~simba_storage()
+			{}
+
+			simba_simple_type simpleValue;
+			details::simba_node<simba_object_type>* objectValue;
+			details::simba_node<simba_array_type>* arrayValue;
+			void* typedArrayValue; // details::simba_node<simba_typed_array_type<T>>
+			std::string string;
+			std::wstring wstring;
+			std::u16string u16string;
+			std::u32string u32string;
+		};
+
+		std::uint8_t simbaType = simba_type_null,
+			simbaTypeFlag = simba_type_flag_signed,
+			simbaElementType = simba_type_null; // only used by typed arrays
+		simba_storage storage{};
+	};
+
+	constexpr auto SIMBA_SIZE = sizeof(simba_value);
+}
+
+namespace std {
+	template<>
+	struct hash<simba::simba_key>
+	{
+		std::size_t operator()(const simba::simba_key& key) const noexcept
+		{
+			return std::hash<const void*>{}(key.data()); // interned, the address identifies the key
+		}
+	};
+}
+
+// a single byte has no byte order
+std::uint8_t simba::details::swap_uint8(std::uint8_t val)
+{
+	return val;
+}
+
+std::int8_t simba::details::swap_int8(std::int8_t val)
+{
+	return val;
+}
+
+std::uint16_t simba::details::swap_uint16(std::uint16_t val)
+{
+	return (val << 8) | (val >> 8);
+}
+
+//! Byte swap short
+std::int16_t simba::details::swap_int16(std::int16_t val)
+{
+	return (val << 8) | ((val >> 8) & 0xFF);
+}
+
+//! Byte swap unsigned int
+std::uint32_t simba::details::swap_uint32(std::uint32_t val)
+{
+	val = ((val << 8) & 0xFF00FF00) | ((val >> 8) & 0xFF00FF);
+	return (val << 16) | (val >> 16);
+}
+
+//! Byte swap int
+std::int32_t simba::details::swap_int32(std::int32_t val)
+{
+	val = ((val << 8) & 0xFF00FF00) | ((val >> 8) & 0xFF00FF);
+	return (val << 16) | ((val >> 16) & 0xFFFF);
+}
+
+std::int64_t simba::details::swap_int64(std::int64_t val)
+{
+	val = ((val << 8) & 0xFF00FF00FF00FF00ULL) | ((val >> 8) & 0x00FF00FF00FF00FFULL);
+	val = ((val << 16) & 0xFFFF0000FFFF0000ULL) | ((val >> 16) & 0x0000FFFF0000FFFFULL);
+	return (val << 32) | ((val >> 32) & 0xFFFFFFFFULL);
+}
+
+std::uint64_t simba::details::swap_uint64(std::uint64_t val)
+{
+	val = ((val << 8) & 0xFF00FF00FF00FF00ULL) | ((val >> 8) & 0x00FF00FF00FF00FFULL);
+	val = ((val << 16) & 0xFFFF0000FFFF0000ULL) | ((val >> 16) & 0x0000FFFF0000FFFFULL);
+	return (val << 32) | (val >> 32);
+}
+
+template<typename T>
+T simba::details::swap_integer(T val)
+{
+	using unsigned_t = std::make_unsigned_t<T>;
+
+	if constexpr (sizeof(T) == 2) {
+		return static_cast<T>(swap_uint16(static_cast<unsigned_t>(val)));
+	}
+	else if constexpr (sizeof(T) == 4) {
+		return static_cast<T>(swap_uint32(static_cast<unsigned_t>(val)));
+	}
+	else if constexpr (sizeof(T) == 8) {
+		return static_cast<T>(swap_uint64(static_cast<unsigned_t>(val)));
+	}
+	else {
+		return val;
+	}
+}
+
+// byte swaps count elements in place, floating point values are swapped through their bit pattern
+template<typename T>
+void simba::details::swap_buffer(T* data, std::size_t count)
+{
+	if constexpr (sizeof(T) > 1) {
+		using bits_t = std::conditional_t<sizeof(T) == 2, std::uint16_t, std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+
+		// the vector kernels do the bulk, the scalar loop the remaining tail
+		const auto done = swap_buffer_simd<sizeof(T)>(reinterpret_cast<unsigned char*>(data), count);
+
+		for (std::size_t i = done; i < count; ++i) {
+			bits_t bits;
+			std::memcpy(&bits, data + i, sizeof(T));
+			bits = swap_integer(bits);
+			std::memcpy(data + i, &bits, sizeof(T));
+		}
+	}
+}
+
+// pshufb mask reversing the bytes of each Width byte element in a 32 byte register, built at compile time.
+// pshufb shuffles within 16 byte lanes, elements never straddle a lane since Width divides 16.
+template<std::size_t Width>
+struct simba::details::swap_shuffle
+{
+	struct table
+	{
+		alignas(32) unsigned char bytes[32];
+	};
+
+	static constexpr table make()
+	{
+		table shuffle{};
+
+		for (std::size_t i = 0u; i < sizeof(shuffle.bytes); ++i) {
+			const auto inLane = i % 16u;
+			shuffle.bytes[i] = static_cast<unsigned char>(inLane - inLane % Width + (Width - 1u - inLane % Width));
+		}
+
+		return shuffle;
+	}
+
+	static constexpr table mask = make();
+};
+
+// reverses the bytes of each Width byte element with pshufb, 32 (AVX2) or 16 (SSSE3) bytes at a time.
+// Returns how many elements were swapped, which is 0 when neither instruction set is available.
+template<std::size_t Width>
+std::size_t simba::details::swap_buffer_simd(unsigned char* data, std::size_t count)
+{
+	std::size_t done = 0u;
+
+#if defined(SIMBA_SIMD_AVX2) || defined(SIMBA_SIMD_SSSE3)
+	const auto* shuffle = simba::details::swap_shuffle<Width>::mask.bytes;
+#endif
+
+#if defined(SIMBA_SIMD_AVX2)
+	const __m256i mask256 = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle));
+
+	for (; done + 32u / Width <= count; done += 32u / Width) {
+		auto* block = reinterpret_cast<__m256i*>(data + done * Width);
+		_mm256_storeu_si256(block, _mm256_shuffle_epi8(_mm256_loadu_si256(block), mask256));
+	}
+#endif
+
+#if defined(SIMBA_SIMD_SSSE3)
+	const __m128i mask128 = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle));
+
+	for (; done + 16u / Width <= count; done += 16u / Width) {
+		auto* block = reinterpret_cast<__m128i*>(data + done * Width);
+		_mm_storeu_si128(block, _mm_shuffle_epi8(_mm_loadu_si128(block), mask128));
+	}
+#endif
+
+	static_cast<void>(data);
+	static_cast<void>(count);
+	return done;
+}
+
+// scalars passed around without their type (simba_view, simba_reader) are a 64 bit pattern,
+// integers are converted and floating point values copied
+template<typename T>
+std::uint64_t simba::details::to_bits(T value)
+{
+	if constexpr (std::is_integral_v<T>) {
+		return static_cast<std::uint64_t>(value);
+	}
+	else {
+		std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t> bits;
+		std::memcpy(&bits, &value, sizeof(T));
+		return bits;
+	}
+}
+
+template<typename T>
+T simba::details::from_bits(std::uint64_t bits)
+{
+	if constexpr (std::is_integral_v<T>) {
+		return static_cast<T>(bits);
+	}
+	else {
+		const auto narrow = static_cast<std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>(bits);
+		T value;
+		std::memcpy(&value, &narrow, sizeof(T));
+		return value;
+	}
+}
+
+// maps signed integers to unsigned ones so that small negative numbers stay small varints
+std::uint64_t simba::details::zigzag(std::int64_t val)
+{
+	return (static_cast<std::uint64_t>(val) << 1) ^ static_cast<std::uint64_t>(val >> 63);
+}
+
+std::int64_t simba::details::unzigzag(std::uint64_t val)
+{
+	return static_cast<std::int64_t>(val >> 1) ^ -static_cast<std::int64_t>(val & 1u);
+}
+
+// a v2 integer varint (zigzag encoded when T is signed) read back as T, throws if it doesn't fit
+template<typename T>
+T simba::details::narrow_varint(std::uint64_t val)
+{
+	if constexpr (std::is_signed_v<T>) {
+		const auto decoded = simba::details::unzigzag(val);
+
+		if (decoded < std::numeric_limits<T>::min() || decoded > std::numeric_limits<T>::max()) {
+			throw std::exception("Stored integer is out of range of its type, corrupted file?");
+		}
+
+		return static_cast<T>(decoded);
+	}
+	else {
+		if (val > std::numeric_limits<T>::max()) {
+			throw std::exception("Stored integer is out of range of its type, corrupted file?");
+		}
+
+		return static_cast<T>(val);
+	}
+}
+
+std::uint8_t simba::details::getEndianess()
+{
+	short int word = 0x0001;
+	return reinterpret_cast<std::int8_t*>(&word)[0] ? little_endian : big_endian;
+}
+
+bool simba::details::hasTypeFlag(const std::uint8_t & type)
+{
+	return type > simba_type_null&& type <= simba_type_int64;
+}
+
+bool simba::details::isSimpleType(const std::uint8_t& type)
+{
+	return type > simba_type_null && type <= simba_type_double;
+}
+
+template<typename T, typename>
+struct simba::details::has_reserve : std::false_type
+{};
+
+template<typename T>
+struct simba::details::has_reserve<T, std::void_t<decltype(std::declval<T&>().reserve(0u))>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::is_output_adapter : std::false_type
+{};
+
+template<typename T>
+struct simba::details::is_output_adapter<T, std::void_t<decltype(std::declval<T&>().write(std::declval<const char*>(), std::streamsize{}))>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::is_input_adapter : std::false_type
+{};
+
+template<typename T>
+struct simba::details::is_input_adapter<T, std::void_t<decltype(std::declval<T&>().read(std::declval<char*>(), std::streamsize{}))>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::has_flush : std::false_type
+{};
+
+template<typename T>
+struct simba::details::has_flush<T, std::void_t<decltype(std::declval<T&>().flush())>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::has_write_reference : std::false_type
+{};
+
+template<typename T>
+struct simba::details::has_write_reference<T, std::void_t<decltype(std::declval<T&>().writeReference(std::declval<const char*>(), std::size_t{}))>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::has_overwrite : std::false_type
+{};
+
+template<typename T>
+struct simba::details::has_overwrite<T, std::void_t<decltype(std::declval<T&>().overwrite(std::uint64_t{}, std::declval<const char*>(), std::streamsize{}))>> : std::true_type
+{};
+
+template<typename T, typename>
+struct simba::details::has_can_overwrite : std::false_type
+{};
+
+template<typename T>
+struct simba::details::has_can_overwrite<T, std::void_t<decltype(std::declval<const T&>().canOverwrite())>> : std::true_type
+{};
+
+template<typename T>
+struct simba::details::is_offset_adapter : std::false_type
+{};
+
+template<typename Adapter>
+struct simba::details::is_offset_adapter<simba::details::simba_offset_output_adapter<Adapter>> : std::true_type
+{};
+
+template<typename T>
+struct simba::details::typed_element
+{
+	static constexpr bool value = false;
+};
+
+template<>
+struct simba::details::typed_element<std::int8_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int8, flag = simba_type_flag_signed;
+};
+
+template<>
+struct simba::details::typed_element<std::uint8_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int8, flag = simba_type_flag_unsigned;
+};
+
+template<>
+struct simba::details::typed_element<std::int16_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int16, flag = simba_type_flag_signed;
+};
+
+template<>
+struct simba::details::typed_element<std::uint16_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int16, flag = simba_type_flag_unsigned;
+};
+
+template<>
+struct simba::details::typed_element<std::int32_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int32, flag = simba_type_flag_signed;
+};
+
+template<>
+struct simba::details::typed_element<std::uint32_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int32, flag = simba_type_flag_unsigned;
+};
+
+template<>
+struct simba::details::typed_element<std::int64_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int64, flag = simba_type_flag_signed;
+};
+
+template<>
+struct simba::details::typed_element<std::uint64_t>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_int64, flag = simba_type_flag_unsigned;
+};
+
+template<>
+struct simba::details::typed_element<float>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_float, flag = simba_type_flag_signed;
+};
+
+template<>
+struct simba::details::typed_element<double>
+{
+	static constexpr bool value = true;
+	static constexpr std::uint8_t type = simba_type_double, flag = simba_type_flag_signed;
+};
+
+// calls f with a value of the element type described by type and flag, returns false for unsupported element types
+template<typename F>
+bool simba::details::visitElementType(std::uint8_t type, std::uint8_t flag, F&& f)
+{
+	const bool isSigned = flag == simba_type_flag_signed;
+
+	switch (type) {
+	case simba_type_int8:
+		isSigned ? f(std::int8_t{}) : f(std::uint8_t{});
+		return true;
+	case simba_type_int16:
+		isSigned ? f(std::int16_t{}) : f(std::uint16_t{});
+		return true;
+	case simba_type_int32:
+		isSigned ? f(std::int32_t{}) : f(std::uint32_t{});
+		return true;
+	case simba_type_int64:
+		isSigned ? f(std::int64_t{}) : f(std::uint64_t{});
+		return true;
+	case simba_type_float:
+		if (isSigned) {
+			f(float{});
+			return true;
+		}
+		return false;
+	case simba_type_double:
+		if (isSigned) {
+			f(double{});
+			return true;
+		}
+		return false;
+	}
+
+	return false;
+}
+
+// runs f(i) for every i in [first, last) on up to threads threads (the calling thread is one of them),
+// the first exception thrown by f stops the remaining iterations and is rethrown
+template<typename F>
+void simba::details::parallel_for(std::size_t threads, std::size_t first, std::size_t last, F&& f)
+{
+	std::atomic<std::size_t> next{ first };
+	std::exception_ptr error;
+	std::mutex errorMutex;
+
+	auto worker = [&]() {
+		for (auto i = next++; i < last; i = next++) {
+			try {
+				f(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock{ errorMutex };
+				if (!error) {
+					error = std::current_exception();
+				}
+				next = last;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (std::size_t i = 1u; i < threads && i < last - first; ++i) {
+		pool.emplace_back(worker);
+	}
+
+	worker();
+
+	for (auto& thread : pool) {
+		thread.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+// number of bits needed to store value
+std::uint8_t simba::details::bit_width(std::uint64_t value)
+{
+	std::uint8_t width = 0u;
+
+	for (; value != 0u; value >>= 1) {
+		++width;
+	}
+
+	return width;
+}
+
+std::size_t simba::details::varint_length(std::uint64_t value)
+{
+	std::size_t length = 1u;
+
+	for (; value >= 0x80u; value >>= 7) {
+		++length;
+	}
+
+	return length;
+}
+
+// Decodes count packed deltas: out[i] = out[i - 1] + reference + the i-th width bit field of packed, starting
+// from previous. packed is little endian and has to be readable for 8 bytes past its last field. Every field
+// is a single unaligned load, shift and mask without branches, the running sum is the only dependency.
+void simba::details::unpack_deltas(const unsigned char* packed, std::size_t count, std::uint8_t width, std::uint64_t previous, std::uint64_t reference, std::uint64_t* out)
+{
+	const std::uint64_t mask = width == 0u ? 0u : ~std::uint64_t{ 0u } >> (64u - width);
+	const bool swap = simba::details::getEndianess() != little_endian;
+
+	for (std::size_t i = 0u; i < count; ++i) {
+		const auto bit = i * width;
+
+		std::uint64_t word;
+		std::memcpy(&word, packed + bit / 8u, sizeof(word));
+
+		if (swap) {
+			word = simba::details::swap_uint64(word);
+		}
+
+		previous += reference + ((word >> (bit % 8u)) & mask);
+		out[i] = previous;
+	}
+}
+
+// worst case size of a compressed block, incompressible input only grows by the literal run lengths
+std::size_t simba::details::lz_bound(std::size_t length)
+{
+	return length + length / 255u + 16u;
+}
+
+// Compresses a block of at most SIMBA_BLOCK_SIZE bytes into dest (lz_bound(length) bytes) and returns the
+// compressed size. The output is a list of sequences: token (literal count << 4 | match length - 4, 15 means
+// more length bytes follow), literals, 16 bit offset, length bytes. The last sequence only has literals.
+// table is scratch space of SIMBA_LZ_HASH_SIZE entries.
+std::size_t simba::details::lz_compress(const char* source, std::size_t length, char* dest, std::uint16_t* table)
+{
+	const auto* src = reinterpret_cast<const unsigned char*>(source);
+	auto* out = reinterpret_cast<unsigned char*>(dest);
+
+	auto writeLength = [&out](std::size_t len) {
+		for (; len >= 255u; len -= 255u) {
+			*out++ = 255u;
+		}
+		*out++ = static_cast<unsigned char>(len);
+	};
+
+	auto writeLiterals = [&out, &writeLength](const unsigned char* literals, std::size_t count, std::uint8_t matchToken) {
+		*out++ = static_cast<unsigned char>((count < 15u ? count : 15u) << 4 | matchToken);
+		if (count >= 15u) {
+			writeLength(count - 15u);
+		}
+		std::memcpy(out, literals, count);
+		out += count;
+	};
+
+	std::fill(table, table + SIMBA_LZ_HASH_SIZE, std::uint16_t{ 0u });
+
+	std::size_t anchor = 0u;
+	std::size_t i = 0u;
+
+	while (i + SIMBA_LZ_MIN_MATCH <= length) {
+		std::uint32_t sequence;
+		std::memcpy(&sequence, src + i, sizeof(sequence));
+
+		const auto hash = (sequence * 2654435761u) >> (32u - SIMBA_LZ_HASH_BITS);
+		const std::size_t candidate = table[hash];
+		table[hash] = static_cast<std::uint16_t>(i);
+
+		std::uint32_t previous;
+		std::memcpy(&previous, src + candidate, sizeof(previous));
+
+		if (candidate >= i || previous != sequence) {
+			// skip faster through data that doesn't compress
+			i += 1u + ((i - anchor) >> 6);
+			continue;
+		}
+
+		auto matchLength = SIMBA_LZ_MIN_MATCH;
+		while (i + matchLength < length && src[candidate + matchLength] == src[i + matchLength]) {
+			++matchLength;
+		}
+
+		const auto matchToken = matchLength - SIMBA_LZ_MIN_MATCH;
+		writeLiterals(src + anchor, i - anchor, static_cast<std::uint8_t>(matchToken < 15u ? matchToken : 15u));
+
+		const auto offset = i - candidate;
+		*out++ = static_cast<unsigned char>(offset);
+		*out++ = static_cast<unsigned char>(offset >> 8);
+
+		if (matchToken >= 15u) {
+			writeLength(matchToken - 15u);
+		}
+
+		i += matchLength;
+		anchor = i;
+	}
+
+	writeLiterals(src + anchor, length - anchor, 0u);
+	return static_cast<std::size_t>(out - reinterpret_cast<unsigned char*>(dest));
+}
+
+// decompresses a block produced by lz_compress into exactly rawLength bytes, throws on malformed input
+void simba::details::lz_decompress(const char* source, std::size_t length, char* dest, std::size_t rawLength)
+{
+	const auto* src = reinterpret_cast<const unsigned char*>(source);
+	const auto* end = src + length;
+	auto* out = reinterpret_cast<unsigned char*>(dest);
+	std::size_t produced = 0u;
+
+	auto readLength = [&src, end]() {
+		std::size_t len = 0u;
+
+		for (;;) {
+			if (src == end) {
+				throw std::exception("Invalid compressed block, corrupted file?");
+			}
+
+			const auto byte = *src++;
+			len += byte;
+
+			if (byte != 255u) {
+				return len;
+			}
+		}
+	};
+
+	for (;;) {
+		if (src == end) {
+			throw std::exception("Invalid compressed block, corrupted file?");
+		}
+
+		const auto token = *src++;
+
+		std::size_t literals = token >> 4;
+		if (literals == 15u) {
+			literals += readLength();
+		}
+
+		if (literals > static_cast<std::size_t>(end - src) || literals > rawLength - produced) {
+			throw std::exception("Invalid compressed block, corrupted file?");
+		}
+
+		std::memcpy(out + produced, src, literals);
+		src += literals;
+		produced += literals;
+
+		if (src == end) {
+			break;
+		}
+
+		if (end - src < 2) {
+			throw std::exception("Invalid compressed block, corrupted file?");
+		}
+
+		const std::size_t offset = src[0] | static_cast<std::size_t>(src[1]) << 8;
+		src += 2;
+
+		std::size_t matchLength = (token & 0x0Fu) + SIMBA_LZ_MIN_MATCH;
+		if ((token & 0x0Fu) == 15u) {
+			matchLength += readLength();
+		}
+
+		if (offset == 0u || offset > produced || matchLength > rawLength - produced) {
+			throw std::exception("Invalid compressed block, corrupted file?");
+		}
+
+		auto* match = out + produced - offset;
+
+		if (offset >= matchLength) {
+			std::memcpy(out + produced, match, matchLength);
+		}
+		else {
+			// overlapping copy repeats the last offset bytes
+			for (std::size_t j = 0u; j < matchLength; ++j) {
+				out[produced + j] = match[j];
+			}
+		}
+
+		produced += matchLength;
+	}
+
+	if (produced != rawLength) {
+		throw std::exception("Invalid compressed block, corrupted file?");
+	}
+}
+
+// only reserves when the container supports it (std::map doesn't)
+template<typename Container>
+void simba::details::reserve(Container& container, std::size_t count)
+{
+	if constexpr (has_reserve<Container>::value) {
+		container.reserve(count);
+	}
+}
+
+template<typename T>
+std::pair<simba::simba_key, simba::simba_value> simba::pair(simba_key key, T&& value)
+{
+	return { std::move(key), simba::simba_value(std::forward<T>(value)) };
+}
+
+template<typename T>
+simba::simba_value simba::val(T && value)
+{
+	return simba_value(std::forward<T>(value));
+}
+
+simba::simba_value simba::val()
+{
+	return simba_value(nullptr);
+}
+
+// the container is reserved up front and every element is constructed in place from its argument
+template<typename ...Args>
+simba::simba_value simba::array(Args && ...args)
+{
+	simba_value::simba_array_type arr;
+	arr.reserve(sizeof...(Args));
+	simba::details::array_impl<Args...>::append(arr, std::forward<Args>(args)...);
+	return simba_value(std::move(arr));
+}
+
+template<typename T, typename ...Args>
+struct simba::details::array_impl<T, Args...>
+{
+	static void append(simba_value::simba_array_type& arr, T&& t, Args&& ...args)
+	{
+		arr.emplace_back(std::forward<T>(t));
+		array_impl<Args...>::append(arr, std::forward<Args>(args)...);
+	}
+};
+
+template<typename T>
+struct simba::details::array_impl<T>
+{
+	static void append(simba_value::simba_array_type& arr, T&& t)
+	{
+		arr.emplace_back(std::forward<T>(t));
+	}
+};
+
+template<>
+struct simba::details::array_impl<>
+{
+	static void append(simba_value::simba_array_type& arr)
+	{}
+};
+
+
+template<typename ...Args>
+simba::simba_value simba::object(Args && ...args)
+{
+	simba_value::simba_object_type obj;
+	simba::details::reserve(obj, sizeof...(Args));
+	simba::details::object_impl<Args...>::append(obj, std::forward<Args>(args)...);
+	return simba_value(std::move(obj));
+}
+
+
+template<typename T>
+simba::simba_value simba::typed_array(const T* data, std::size_t count)
+{
+	return simba_value(simba_value::simba_typed_array_type<T>(data, data + count));
+}
+
+template<typename T>
+simba::simba_value simba::typed_array(const std::vector<T>& values)
+{
+	return simba::typed_array(values.data(), values.size());
+}
+
+// pairs are moved into the object when passed as temporaries (the usual simba::pair case)
+template<typename T, typename...Args>
+struct simba::details::object_impl<T, Args...>
+{
+	static void append(simba_value::simba_object_type& obj, T&& pair, Args&& ...args)
+	{
+		obj.insert_or_assign(std::forward<T>(pair).first, std::forward<T>(pair).second);
+		object_impl<Args...>::append(obj, std::forward<Args>(args)...);
+	}
+};
+
+template<typename T>
+struct simba::details::object_impl<T>
+{
+	static void append(simba_value::simba_object_type& obj, T&& pair)
+	{
+		obj.insert_or_assign(std::forward<T>(pair).first, std::forward<T>(pair).second);
+	}
+};
+
+template<>
+struct simba::details::object_impl<>
+{
+	static void append(simba_value::simba_object_type& obj)
+	{}
+};
+
+class simba::details::simba_input_adapter
+{
+public:
+	// return the size of the input buffer
+	virtual std::streamsize size() const = 0;
+
+	// return the cursor position
+	virtual std::streamsize cur() const = 0;
+
+	// read length amount of bytes into buffer
+	virtual std::streamsize read(char* buffer, std::streamsize length) = 0;
+};
+
+// Reads from a block of memory the caller keeps alive, every read is a bounds check and a memcpy.
+class simba::details::simba_memory_input_adapter final : public simba::details::simba_input_adapter
+{
+public:
+	simba_memory_input_adapter(const char* data, std::size_t length)
+		: data(data), length(static_cast<std::streamsize>(length))
+	{}
+
+	std::streamsize size() const
+	{
+		return this->length;
+	}
+
+	std::streamsize cur() const
+	{
+		return this->cursor;
+	}
+
+	std::streamsize read(char* buffer, std::streamsize length)
+	{
+		if (length > this->length - this->cursor) {
+			throw std::exception("Attempted to read past the end of the input, corrupted file?");
+		}
+
+		std::memcpy(buffer, this->data + this->cursor, static_cast<std::size_t>(length));
+		this->cursor += length;
+		return length;
+	}
+
+private:
+	const char* data;
+	std::streamsize length;
+	std::streamsize cursor = 0u;
+};
+
+// Same as simba_memory_input_adapter, but keeps its own copy of the input.
+class simba::details::simba_string_input_adapter final : public simba::details::simba_input_adapter
+{
+public:
+	simba_string_input_adapter(std::string str)
+		: str(std::move(str))
+	{}
+
+	std::streamsize size() const
+	{
+		return static_cast<std::streamsize>(this->str.length());
+	}
+
+	std::streamsize cur() const
+	{
+		return this->cursor;
+	}
+
+	std::streamsize read(char* buffer, std::streamsize length)
+	{
+		if (length > this->size() - this->cursor) {
+			throw std::exception("Attempted to read past the end of the input, corrupted file?");
+		}
+
+		std::memcpy(buffer, this->str.data() + this->cursor, static_cast<std::size_t>(length));
+		this->cursor += length;
+		return length;
+	}
+
+private:
+	std::string str;
+	std::streamsize cursor = 0u;
+};
+
+class simba::details::simba_stream_input_adapter : public simba::details::simba_input_adapter
+{
+public:
+	simba_stream_input_adapter(std::basic_istream<char>& file)
+		: inputFile(&file)
+	{
+		this->inputFile->seekg(0, std::ios::end);
+		this->fileLength = this->inputFile->tellg();
+
+		if (this->fileLength < 0) {
+			// not seekable, the length is only known by reading everything
+			this->inputFile->clear();
+			this->inputFile->ignore(std::numeric_limits<std::streamsize>::max());
+			this->fileLength = this->inputFile->gcount();
+		}
+
+		this->inputFile->clear();
+		this->inputFile->seekg(0, std::ios::beg);
+	}
+
+	std::streamsize size() const
+	{
+		return this->fileLength;
+	}
+
+	std::streamsize cur() const
+	{
+		return this->inputFile->tellg();
+	}
+
+	std::streamsize read(char* buffer, std::streamsize length)
+	{
+		this->inputFile->read(buffer, length);
+		return this->inputFile->gcount();
+	}
+
+private:
+	std::basic_istream<char>* inputFile = nullptr;
+	std::streamsize fileLength = 0u;
+};
+
+#if defined(SIMBA_HAS_MMAP)
+// Maps a whole file read-only and reads from the mapping like simba_memory_input_adapter, so the file is
+// decoded straight from the page cache without copying it through a stream buffer first.
+class simba::details::simba_mmap_input_adapter final : public simba::details::simba_input_adapter
+{
+public:
+	explicit simba_mmap_input_adapter(const std::string& filename)
+	{
+		const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "Failed to open the input file");
+		}
+
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "Failed to read the size of the input file");
+		}
+
+		this->length = static_cast<std::streamsize>(info.st_size);
+
+		if (this->length != 0) {
+			void* mapping = ::mmap(nullptr, static_cast<std::size_t>(this->length), PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (mapping == MAP_FAILED) {
+				const int error = errno;
+				::close(fd);
+				throw std::system_error(error, std::generic_category(), "Failed to map the input file");
+			}
+
+			// the decoder reads front to back, let the kernel read ahead and drop pages behind
+			::madvise(mapping, static_cast<std::size_t>(this->length), MADV_SEQUENTIAL);
+			this->data = static_cast<const char*>(mapping);
+		}
+
+		// the mapping stays valid without the descriptor
+		::close(fd);
+	}
+
+	simba_mmap_input_adapter(const simba_mmap_input_adapter&) = delete;
+	simba_mmap_input_adapter& operator=(const simba_mmap_input_adapter&) = delete;
+
+	~simba_mmap_input_adapter()
+	{
+		if (this->data != nullptr) {
+			::munmap(const_cast<char*>(this->data), static_cast<std::size_t>(this->length));
+		}
+	}
+
+	std::streamsize size() const
+	{
+		return this->length;
+	}
+
+	std::streamsize cur() const
+	{
+		return this->cursor;
+	}
+
+	std::streamsize read(char* buffer, std::streamsize length)
+	{
+		if (length > this->length - this->cursor) {
+			throw std::runtime_error("Attempted to read past the end of the input, corrupted file?");
+		}
+
+		std::memcpy(buffer, this->data + this->cursor, static_cast<std::size_t>(length));
+		this->cursor += length;
+		return length;
+	}
+
+	// the whole mapping, valid for as long as the adapter lives (e.g. to build a simba_view over the file)
+	std::string_view bytes() const noexcept
+	{
+		return { this->data, static_cast<std::size_t>(this->length) };
+	}
+
+private:
+	const char* data = nullptr;
+	std::streamsize length = 0;
+	std::streamsize cursor = 0;
+};
+#endif
+
+// Reads the blocks written by simba_compress_output_adapter from another adapter, one block at a time.
+// size() and cur() refer to the decompressed data seen so far.
+template<typename Adapter>
+class simba::details::simba_decompress_input_adapter final : public simba::details::simba_input_adapter
+{
+public:
+	simba_decompress_input_adapter(Adapter& input)
+		: input(&input), block(new char[simba::details::SIMBA_BLOCK_SIZE])
+	{}
+
+	std::streamsize size() const
+	{
+		return this->consumed + (this->end - this->block.get());
+	}
+
+	std::streamsize cur() const
+	{
+		return this->consumed + (this->cursor - this->block.get());
+	}
+
+	std::streamsize read(char* buffer, std::streamsize length)
+	{
+		const auto size = static_cast<std::size_t>(length);
+
+		if (size <= static_cast<std::size_t>(this->end - this->cursor)) {
+			std::memcpy(buffer, this->cursor, size);
+			this->cursor += size;
+			return length;
+		}
+
+		this->readAcrossBlocks(buffer, size);
+		return length;
+	}
+
+private:
+	void readAcrossBlocks(char* buffer, std::size_t remaining)
+	{
+		while (remaining != 0u) {
+			if (this->cursor == this->end) {
+				this->readBlock();
+			}
+
+			const auto count = std::min(remaining, static_cast<std::size_t>(this->end - this->cursor));
+			std::memcpy(buffer, this->cursor, count);
+			this->cursor += count;
+			buffer += count;
+			remaining -= count;
+		}
+	}
+
+	void readBlock()
+	{
+		const auto rawSize = this->readVarint();
+		const auto storedSize = this->readVarint();
+
+		if (rawSize == 0u || rawSize > simba::details::SIMBA_BLOCK_SIZE || storedSize > rawSize) {
+			throw std::exception("Invalid compressed block, corrupted file?");
+		}
+
+		this->consumed += this->end - this->block.get();
+		this->cursor = this->end = this->block.get(); // nothing left to read if the block turns out to be corrupted
+
+		if (storedSize == rawSize) {
+			this->readInput(this->block.get(), static_cast<std::size_t>(rawSize));
+		}
+		else {
+			this->compressed.resize(static_cast<std::size_t>(storedSize));
+			this->readInput(this->compressed.data(), this->compressed.size());
+			simba::details::lz_decompress(this->compressed.data(), this->compressed.size(), this->block.get(), static_cast<std::size_t>(rawSize));
+		}
+
+		this->end = this->block.get() + rawSize;
+	}
+
+	void readInput(char* buffer, std::size_t length)
+	{
+		if (this->input->read(buffer, static_cast<std::streamsize>(length)) != static_cast<std::streamsize>(length)) {
+			throw std::exception("Attempted to read past the end of the input, corrupted file?");
+		}
+	}
+
+	std::uint64_t readVarint()
+	{
+		std::uint64_t result{ 0u };
+
+		for (auto shift = 0u; shift < 64u; shift += 7u) {
+			std::uint8_t byte{ 0u };
+			this->readInput(reinterpret_cast<char*>(&byte), 1u);
+
+			result |= static_cast<std::uint64_t>(byte & 0x7Fu) << shift;
+
+			if (!(byte & 0x80u)) {
+				return result;
+			}
+		}
+
+		throw std::exception("Invalid varint, corrupted file?");
+	}
+
+private:
+	Adapter* input;
+	std::unique_ptr<char[]> block;
+	std::vector<char> compressed;
+	const char* cursor = nullptr;
+	const char* end = nullptr;
+	std::streamsize consumed = 0;
+};
+
+class simba::details::simba_output_adapter
+{
+public:
+	virtual std::streamsize write(const char* buffer, std::streamsize len) = 0;
+
+	// push out anything the adapter buffered, the serializer calls this once it's done
+	virtual void flush()
+	{}
+
+	// whether overwrite() works on this output, adapters that support it override both
+	virtual bool canOverwrite() const
+	{
+		return false;
+	}
+
+	// replace len bytes written before, offset counts from the first byte written through the adapter
+	virtual void overwrite(std::uint64_t, const char*, std::streamsize)
+	{
+		throw std::exception("The output can't be overwritten, pass the count up front");
+	}
+};
+
+// Collects the output in chunks and hands them to the stream in large writes,
+// the serializer produces a lot of 1-8 byte writes which are expensive through std::ostream::write.
+// The chunk lives in the adapter itself so writing to a stream doesn't allocate.
+class simba::details::simba_stream_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	static constexpr std::size_t CHUNK_SIZE = 8 * 1024;
+
+public:
+	simba_stream_output_adapter(std::basic_ostream<char>& file)
+		: file(&file), start(file.tellp())
+	{}
+
+	~simba_stream_output_adapter()
+	{
+		this->flush();
+	}
+
+	std::streamsize write(const char* buffer, std::streamsize len)
+	{
+		const auto size = static_cast<std::size_t>(len);
+		this->written += size;
+
+		if (this->used + size > CHUNK_SIZE) {
+			this->flush();
+
+			if (size >= CHUNK_SIZE) {
+				// large payloads go straight to the stream
+				this->file->write(buffer, len);
+				return len;
+			}
+		}
+
+		std::memcpy(this->chunk + this->used, buffer, size);
+		this->used += size;
+		return len;
+	}
+
+	void flush()
+	{
+		if (this->used != 0u) {
+			this->file->write(this->chunk, static_cast<std::streamsize>(this->used));
+			this->used = 0u;
+		}
+	}
+
+	// only a seekable stream can be overwritten, a count might already have left the chunk when it's patched
+	bool canOverwrite() const
+	{
+		return this->start != std::streampos(-1);
+	}
+
+	// bytes still in the chunk are replaced in place, anything older needs a seekable stream
+	void overwrite(std::uint64_t offset, const char* buffer, std::streamsize len)
+	{
+		const auto flushed = this->written - this->used;
+
+		if (offset + static_cast<std::uint64_t>(len) > this->written) {
+			throw std::exception("Attempted to overwrite past the end of the output");
+		}
+
+		if (offset >= flushed) {
+			std::memcpy(this->chunk + (offset - flushed), buffer, static_cast<std::size_t>(len));
+			return;
+		}
+
+		this->flush();
+
+		if (this->start == std::streampos(-1)) {
+			throw std::exception("The output stream isn't seekable, pass the count up front");
+		}
+
+		const auto end = this->file->tellp();
+		this->file->seekp(this->start + static_cast<std::streamoff>(offset));
+		this->file->write(buffer, len);
+		this->file->seekp(end);
+	}
+
+private:
+	std::basic_ostream<char>* file;
+	std::streampos start;
+	std::uint64_t written = 0u;
+	std::size_t used = 0u;
+	char chunk[CHUNK_SIZE];
+};
+
+// Appends the output to a contiguous buffer (std::vector<char>, std::string, ...)
+template<typename Container>
+class simba::details::simba_buffer_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	simba_buffer_output_adapter(Container& buffer)
+		: buffer(&buffer), start(buffer.size())
+	{}
+
+	std::streamsize write(const char* data, std::streamsize len)
+	{
+		this->buffer->insert(this->buffer->end(), data, data + len);
+		return len;
+	}
+
+	bool canOverwrite() const
+	{
+		return true;
+	}
+
+	void overwrite(std::uint64_t offset, const char* data, std::streamsize len)
+	{
+		if (offset + static_cast<std::uint64_t>(len) > this->buffer->size() - this->start) {
+			throw std::exception("Attempted to overwrite past the end of the output");
+		}
+
+		std::copy(data, data + len, std::next(this->buffer->begin(), static_cast<std::ptrdiff_t>(this->start + offset)));
+	}
+
+private:
+	Container* buffer;
+	std::size_t start;
+};
+
+// Writes into a fixed block of memory, every write is a bounds check and a memcpy.
+class simba::details::simba_pointer_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	simba_pointer_output_adapter(char* data, std::size_t capacity)
+		: data(data), capacity(capacity)
+	{}
+
+	std::streamsize write(const char* data, std::streamsize len)
+	{
+		if (static_cast<std::size_t>(len) > this->capacity - this->cursor) {
+			throw std::exception("Serialized value doesn't fit into the output buffer");
+		}
+
+		std::memcpy(this->data + this->cursor, data, static_cast<std::size_t>(len));
+		this->cursor += static_cast<std::size_t>(len);
+		return len;
+	}
+
+	std::size_t written() const
+	{
+		return this->cursor;
+	}
+
+	bool canOverwrite() const
+	{
+		return true;
+	}
+
+	void overwrite(std::uint64_t offset, const char* data, std::streamsize len)
+	{
+		if (offset + static_cast<std::uint64_t>(len) > this->cursor) {
+			throw std::exception("Attempted to overwrite past the end of the output");
+		}
+
+		std::memcpy(this->data + offset, data, static_cast<std::size_t>(len));
+	}
+
+private:
+	char* data;
+	std::size_t capacity;
+	std::size_t cursor = 0u;
+};
+
+// Only counts the bytes, used to compute the serialized size without producing any output.
+class simba::details::simba_size_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	std::streamsize write(const char*, std::streamsize len)
+	{
+		this->count += static_cast<std::uint64_t>(len);
+		return len;
+	}
+
+	void skip(std::uint64_t len)
+	{
+		this->count += len;
+	}
+
+	std::uint64_t size() const
+	{
+		return this->count;
+	}
+
+private:
+	std::uint64_t count = 0u;
+};
+
+// Compresses everything written to it in independent blocks of up to SIMBA_BLOCK_SIZE bytes and passes
+// them on to another adapter. A block is its raw size and stored size (varints) followed by the data, a
+// stored size equal to the raw size means the block didn't compress and is kept as is. Blocks never
+// reference each other, so they can be decompressed in any order. flush() writes the pending block,
+// the serializer calls it when it's done.
+template<typename Adapter>
+class simba::details::simba_compress_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	simba_compress_output_adapter(Adapter& output)
+		: output(&output)
+	{
+		this->block.reserve(simba::details::SIMBA_BLOCK_SIZE);
+	}
+
+	std::streamsize write(const char* buffer, std::streamsize len)
+	{
+		auto remaining = static_cast<std::size_t>(len);
+
+		while (remaining != 0u) {
+			const auto count = std::min(remaining, simba::details::SIMBA_BLOCK_SIZE - this->block.size());
+			this->block.insert(this->block.end(), buffer, buffer + count);
+			buffer += count;
+			remaining -= count;
+
+			if (this->block.size() == simba::details::SIMBA_BLOCK_SIZE) {
+				this->writeBlock();
+			}
+		}
+
+		return len;
+	}
+
+	void flush()
+	{
+		if (!this->block.empty()) {
+			this->writeBlock();
+		}
+
+		if constexpr (simba::details::has_flush<Adapter>::value) {
+			this->output->flush();
+		}
+	}
+
+private:
+	void writeBlock()
+	{
+		this->compressed.resize(simba::details::lz_bound(this->block.size()));
+
+		auto size = simba::details::lz_compress(this->block.data(), this->block.size(), this->compressed.data(), this->table);
+		const bool stored = size >= this->block.size();
+
+		if (stored) {
+			size = this->block.size();
+		}
+
+		this->writeVarint(this->block.size());
+		this->writeVarint(size);
+		this->output->write(stored ? this->block.data() : this->compressed.data(), static_cast<std::streamsize>(size));
+		this->block.clear();
+	}
+
+	void writeVarint(std::size_t value)
+	{
+		char buffer[10];
+		std::size_t len = 0u;
+
+		while (value >= 0x80u) {
+			buffer[len++] = static_cast<char>(value | 0x80u);
+			value >>= 7;
+		}
+
+		buffer[len++] = static_cast<char>(value);
+		this->output->write(buffer, static_cast<std::streamsize>(len));
+	}
+
+private:
+	Adapter* output;
+	std::vector<char> block;
+	std::vector<char> compressed;
+	std::uint16_t table[simba::details::SIMBA_LZ_HASH_SIZE];
+};
+
+// Passes everything on to another adapter and counts it, offset() is the position the next write lands at.
+// The serializer writes through it when it builds an index.
+template<typename Adapter>
+class simba::details::simba_offset_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	simba_offset_output_adapter(Adapter& output)
+		: output(&output)
+	{}
+
+	std::streamsize write(const char* buffer, std::streamsize len)
+	{
+		this->output->write(buffer, len);
+		this->position += static_cast<std::uint64_t>(len);
+		return len;
+	}
+
+	template<typename A = Adapter, typename = std::enable_if_t<simba::details::has_write_reference<A>::value>>
+	void writeReference(const char* data, std::size_t len)
+	{
+		this->output->writeReference(data, len);
+		this->position += len;
+	}
+
+	std::uint64_t offset() const noexcept
+	{
+		return this->position;
+	}
+
+private:
+	Adapter* output;
+	std::uint64_t position = 0u;
+};
+
+#if defined(SIMBA_HAS_WRITEV)
+// Gathers the output into iovecs and writes them to a file descriptor with writev. Small writes are
+// staged in a buffer, payloads passed to writeReference() are only referenced, so they have to stay
+// valid until the next flush (the serializer does this for string contents and typed arrays).
+class simba::details::simba_fd_output_adapter final : public simba::details::simba_output_adapter
+{
+public:
+	static constexpr std::size_t STAGING_SIZE = 64 * 1024;
+	static constexpr std::size_t MAX_VECTORS = 1024; // IOV_MAX on linux and macOS
+	static constexpr std::size_t REFERENCE_THRESHOLD = 4096;
+
+public:
+	simba_fd_output_adapter(int fd, std::size_t referenceThreshold = REFERENCE_THRESHOLD)
+		: fd(fd), referenceThreshold(referenceThreshold), start(::lseek(fd, 0, SEEK_CUR))
+	{
+		this->staging.reserve(STAGING_SIZE);
+	}
+
+	// write errors surface from flush(), which the serializer calls before it returns. Throwing from here would
+	// terminate while unwinding, so output still pending when the adapter is destroyed is written best effort.
+	~simba_fd_output_adapter()
+	{
+		try {
+			this->flush();
+		}
+		catch (...) {
+		}
+	}
+
+	std::streamsize write(const char* buffer, std::streamsize len)
+	{
+		const auto size = static_cast<std::size_t>(len);
+
+		if (size >= STAGING_SIZE) {
+			// the caller's buffer is only valid during this call, reference it and write right away
+			this->addPart(buffer, 0u, size);
+			this->flush();
+			return len;
+		}
+
+		if (this->staging.size() + size > STAGING_SIZE) {
+			this->flush();
+		}
+
+		if (!this->parts.empty() && this->parts.back().data == nullptr) {
+			this->parts.back().size += size;
+		}
+		else {
+			this->addPart(nullptr, this->staging.size(), size);
+		}
+
+		this->staging.insert(this->staging.end(), buffer, buffer + size);
+		return len;
+	}
+
+	void writeReference(const char* buffer, std::size_t len)
+	{
+		if (len < this->referenceThreshold) {
+			this->write(buffer, static_cast<std::streamsize>(len));
+			return;
+		}
+
+		this->addPart(buffer, 0u, len);
+	}
+
+	void flush()
+	{
+		this->vectors.clear();
+
+		for (const auto& part : this->parts) {
+			const char* base = part.data != nullptr ? part.data : this->staging.data() + part.offset;
+			this->vectors.push_back(iovec{ const_cast<char*>(base), part.size });
+		}
+
+		for (std::size_t index = 0u; index < this->vectors.size();) {
+			const auto count = static_cast<int>(std::min(this->vectors.size() - index, MAX_VECTORS));
+			auto written = ::writev(this->fd, this->vectors.data() + index, count);
+
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+
+			if (written <= 0) {
+				const int error = written < 0 ? errno : EIO;
+				this->parts.clear();
+				this->staging.clear();
+				throw std::system_error(error, std::generic_category(), "Failed to write to the file descriptor");
+			}
+
+			// skip what was written, a short write can end in the middle of a vector
+			for (auto remaining = static_cast<std::size_t>(written); remaining > 0u;) {
+				auto& vector = this->vectors[index];
+
+				if (remaining >= vector.iov_len) {
+					remaining -= vector.iov_len;
+					++index;
+				}
+				else {
+					vector.iov_base = static_cast<char*>(vector.iov_base) + remaining;
+					vector.iov_len -= remaining;
+					remaining = 0u;
+				}
+			}
+		}
+
+		this->parts.clear();
+		this->staging.clear();
+	}
+
+	bool canOverwrite() const
+	{
+		return this->start >= 0;
+	}
+
+	// writes everything pending first, then replaces the bytes with pwrite (regular files only, not pipes or sockets)
+	void overwrite(std::uint64_t offset, const char* buffer, std::streamsize len)
+	{
+		this->flush();
+
+		if (this->start < 0) {
+			throw std::runtime_error("The file descriptor isn't seekable, pass the count up front");
+		}
+
+		auto position = static_cast<off_t>(this->start + static_cast<off_t>(offset));
+
+		for (auto remaining = static_cast<std::size_t>(len); remaining > 0u;) {
+			const auto written = ::pwrite(this->fd, buffer, remaining, position);
+
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+
+			if (written <= 0) {
+				throw std::system_error(written < 0 ? errno : EIO, std::generic_category(), "Failed to write to the file descriptor");
+			}
+
+			buffer += written;
+			position += written;
+			remaining -= static_cast<std::size_t>(written);
+		}
+	}
+
+private:
+	// data is nullptr for staged bytes, which are located by offset since the staging buffer may move
+	struct part
+	{
+		const char* data;
+		std::size_t offset;
+		std::size_t size;
+	};
+
+	void addPart(const char* data, std::size_t offset, std::size_t size)
+	{
+		if (size == 0u) {
+			return;
+		}
+
+		if (this->parts.size() == MAX_VECTORS) {
+			this->flush();
+			offset = 0u;
+		}
+
+		this->parts.push_back(part{ data, offset, size });
+	}
+
+private:
+	int fd;
+	std::size_t referenceThreshold;
+	off_t start; // -1 if the descriptor can't seek
+	std::vector<char> staging;
+	std::vector<part> parts;
+	std::vector<iovec> vectors;
+};
+#endif
+
+// Encoding itself never allocates, keys and values are written straight from the tree. Only the output
+// may: toString()/toBuffer(vector) grow it once, parallel() builds a segment plan and index() collects offsets.
+class simba::details::simba_serializer
+{
+	// encodes scalars, strings and whole values through the serializer
+	template<typename Adapter>
+	friend class simba::simba_writer;
+
+public:
+	using adapter_t = simba::details::simba_output_adapter;
+
+public:
+	simba_serializer(const simba_value* value)
+		: value(value)
+	{}
+
+	// goes through the virtual simba_output_adapter interface
+	void to(adapter_t& stream)
+	{
+		this->writeTo(stream);
+	}
+
+	// any type with write(const char*, std::streamsize) (and optionally flush()), the writes
+	// are dispatched statically so the compiler can inline them into the serializer
+	template<typename Adapter, typename = std::enable_if_t<simba::details::is_output_adapter<Adapter>::value>>
+	void to(Adapter& stream)
+	{
+		this->writeTo(stream);
+	}
+
+	void to(const std::string& filename)
+	{
+#if defined(SIMBA_HAS_WRITEV)
+		const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "Failed to open the output file");
+		}
+
+		try {
+			simba::details::simba_fd_output_adapter adapter{ fd };
+			this->to(adapter);
+		}
+		catch (...) {
+			::close(fd);
+			throw;
+		}
+
+		::close(fd);
+#else
+		std::ofstream fileStream{ filename, std::ios::binary };
+		simba::details::simba_stream_output_adapter adapter{ fileStream };
+		this->to(adapter);
+#endif
+	}
+
+	// appends the serialized value to buffer, growing it once to the exact size
+	void toBuffer(std::vector<char>& buffer)
+	{
+		this->toContainer(buffer);
+	}
+
+	// writes into memory the caller owns (e.g. a shared memory slot sized with size()) and returns
+	// the number of bytes written, throws if capacity is too small
+	std::size_t toBuffer(char* data, std::size_t capacity)
+	{
+		if (this->encodesInPlace()) {
+			std::uint64_t total = 0u;
+			auto segments = this->prepareSegments(total);
+
+			if (total > capacity) {
+				throw std::exception("Serialized value doesn't fit into the output buffer");
+			}
+
+			this->writeParallelTo(data, segments);
+			return static_cast<std::size_t>(total);
+		}
+
+		simba::details::simba_pointer_output_adapter adapter{ data, capacity };
+		this->to(adapter);
+		return adapter.written();
+	}
+
+	std::string toString()
+	{
+		std::string result;
+		this->toContainer(result);
+		return result;
+	}
+
+	// select the wire format to write, e.g. SIMBA_FORMAT_V1 for readers that predate v2
+	simba_serializer& format(std::uint8_t version)
+	{
+		if (version < simba::SIMBA_FORMAT_V1 || version > simba::SIMBA_FORMAT_VERSION) {
+			throw std::exception("Unsupported simba format version");
+		}
+
+		this->version = version;
+		return *this;
+	}
+
+	// store everything after the header in LZ compressed blocks (format v2 and up)
+	simba_serializer& compress(bool enabled = true)
+	{
+		this->compressed = enabled;
+		return *this;
+	}
+
+	// Store every string value and object key that occurs more than once in a table following the header
+	// and write references to it instead (format v2 and up). The table is built right away, by walking the value.
+	simba_serializer& deduplicate(bool enabled = true)
+	{
+		this->deduplicated = enabled;
+		this->stringIndex.clear();
+		this->keyIndex.clear();
+		this->stringTable.clear();
+
+		if (enabled) {
+			this->buildStringTable();
+		}
+
+		return *this;
+	}
+
+	// Write integer typed arrays and regular arrays holding integers of a single type delta encoded and
+	// bit-packed whenever that is smaller, e.g. timestamps or ids (format v2 and up).
+	simba_serializer& packIntegers(bool enabled = true)
+	{
+		this->packed = enabled;
+		return *this;
+	}
+
+	// Append an index of the children of every array and object with at least SIMBA_MIN_INDEXED_COUNT of them,
+	// simba_view uses it to jump straight to an element, binary search a key or skip a whole container.
+	// Format v2 and up, can't be combined with compress() and is always encoded on a single thread.
+	simba_serializer& index(bool enabled = true)
+	{
+		this->indexed = enabled;
+		return *this;
+	}
+
+	// Encode on up to threads threads, 0 uses one per core. Large arrays and objects are split into
+	// segments that are encoded independently and emitted in order, so the output is byte-identical
+	// to the single threaded one. The value must not be modified while it's being serialized.
+	simba_serializer& parallel(std::size_t threads = 0u)
+	{
+		if (threads == 0u) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		this->threads = threads;
+		return *this;
+	}
+
+	// exact number of bytes to() will write
+	std::size_t size()
+	{
+		if (this->encodesInPlace()) {
+			std::uint64_t total = 0u;
+			this->prepareSegments(total);
+			return static_cast<std::size_t>(total);
+		}
+
+		simba::details::simba_size_output_adapter counter;
+		this->writeTo(counter);
+		return static_cast<std::size_t>(counter.size());
+	}
+
+private:
+	// a piece of the output that can be encoded on its own: literal bytes (container headers and
+	// object keys) followed by either a whole value, a run of array elements or a run of object pairs
+	struct segment
+	{
+		std::string literal;
+		const simba_value* value = nullptr;
+		const simba_value* firstElement = nullptr;
+		const simba_value* lastElement = nullptr;
+		simba_value::simba_object_type::const_iterator firstPair{};
+		simba_value::simba_object_type::const_iterator lastPair{};
+		bool isObjectRange = false;
+		bool isLeaf = false; // packed arrays are written as a whole
+		std::uint64_t size = 0u;
+	};
+
+	// an indexed array or object, see writeIndex
+	struct index_entry
+	{
+		std::uint64_t offset = 0u;
+		std::uint64_t end = 0u;
+		std::vector<std::uint64_t> children;
+	};
+
+	// occurrences of every string value and key, in the order they are written
+	struct string_counts
+	{
+		std::unordered_map<std::string_view, std::uint32_t> values;
+		std::unordered_map<const std::string*, std::uint32_t> keys;
+		std::unordered_map<std::string_view, const std::string*> seen; // interned copy if used as a key
+		std::vector<std::string_view> order;
+	};
+
+	template<typename Container>
+	void toContainer(Container& buffer)
+	{
+		const auto offset = buffer.size();
+
+		if (this->compressed) {
+			// the compressed size is only known after compressing, no point in sizing first
+			simba::details::simba_buffer_output_adapter<Container> adapter{ buffer };
+			this->writeTo(adapter);
+			return;
+		}
+
+		if (this->encodesInPlace()) {
+			std::uint64_t total = 0u;
+			auto segments = this->prepareSegments(total);
+
+			buffer.resize(offset + static_cast<std::size_t>(total));
+			this->writeParallelTo(buffer.data() + offset, segments);
+			return;
+		}
+
+		buffer.resize(offset + this->size());
+
+		simba::details::simba_pointer_output_adapter adapter{ buffer.data() + offset, buffer.size() - offset };
+		this->writeTo(adapter);
+	}
+
+	template<typename Adapter>
+	void writeTo(Adapter& stream)
+	{
+		if (this->indexed) {
+			// offsets are counted from the first byte of the header
+			simba::details::simba_offset_output_adapter<Adapter> counted{ stream };
+			this->indexEntries.clear();
+			this->writeHeader(counted);
+			this->writeBody(counted);
+			this->writeIndex(counted);
+
+			if constexpr (simba::details::has_flush<Adapter>::value) {
+				stream.flush();
+			}
+			return;
+		}
+
+		this->writeHeader(stream);
+
+		if (this->compressed) {
+			simba::details::simba_compress_output_adapter<Adapter> blocks{ stream };
+			this->writeBody(blocks);
+			blocks.flush();
+			return;
+		}
+
+		this->writeBody(stream);
+
+		if constexpr (simba::details::has_flush<Adapter>::value) {
+			stream.flush();
+		}
+	}
+
+	template<typename Adapter>
+	void writeBody(Adapter& stream)
+	{
+		if (this->deduplicated) {
+			this->writeStringTable(stream);
+		}
+
+		if (this->threads > 1u && !this->indexed && !std::is_same_v<Adapter, simba::details::simba_size_output_adapter>) {
+			this->writeParallel(stream);
+		}
+		else {
+			this->writeElement(stream, this->value);
+		}
+	}
+
+	// parallel encoding straight into the output, the header is the only thing written outside of segments
+	bool encodesInPlace() const
+	{
+		return this->threads > 1u && !this->compressed && !this->deduplicated && !this->indexed;
+	}
+
+	// segments are encoded one batch (a segment per thread) at a time and handed to the stream in order,
+	// which keeps the memory needed for a huge value bounded
+	template<typename Adapter>
+	void writeParallel(Adapter& stream)
+	{
+		std::uint64_t total = 0u;
+		auto segments = this->prepareSegments(total);
+		std::vector<char> batch;
+
+		for (std::size_t first = 0u, last = 0u; first < segments.size(); first = last) {
+			last = std::min(first + this->threads, segments.size());
+
+			std::uint64_t batchSize = 0u;
+			for (auto i = first; i < last; ++i) {
+				batchSize += segments[i].size;
+			}
+
+			batch.resize(static_cast<std::size_t>(batchSize));
+			this->encodeSegments(segments, first, last, batch.data());
+			stream.write(batch.data(), static_cast<std::streamsize>(batchSize));
+		}
+	}
+
+	// header followed by every segment, out has to hold the total computed by prepareSegments()
+	void writeParallelTo(char* out, const std::vector<segment>& segments)
+	{
+		simba::details::simba_pointer_output_adapter header{ out, simba::SIMBA_HEADER_LEN + 3u };
+		this->writeHeader(header);
+		this->encodeSegments(segments, 0u, segments.size(), out + header.written());
+	}
+
+	// splits the value into segments and sizes them, total receives the size of the whole output
+	std::vector<segment> prepareSegments(std::uint64_t& total)
+	{
+		auto segments = this->planSegments();
+
+		simba::details::parallel_for(this->threads, 0u, segments.size(), [this, &segments](std::size_t i) {
+			simba::details::simba_size_output_adapter counter;
+			this->encodeSegment(counter, segments[i]);
+			segments[i].size = counter.size();
+		});
+
+		simba::details::simba_size_output_adapter header;
+		this->writeHeader(header);
+
+		total = header.size();
+		for (const auto& part : segments) {
+			total += part.size;
+		}
+
+		return segments;
+	}
+
+	// keeps splitting the array or object with the most elements until there are enough segments
+	// to keep every thread busy (or nothing is left to split)
+	std::vector<segment> planSegments()
+	{
+		const auto target = this->threads * 8u;
+		std::vector<segment> segments(1u);
+		segments.front().value = this->value;
+
+		while (segments.size() < target) {
+			auto largest = segments.end();
+
+			for (auto it = segments.begin(); it != segments.end(); ++it) {
+				if (it->value == nullptr || it->isLeaf || it->value->size() == 0u
+					|| (it->value->getType() != simba_type_array && it->value->getType() != simba_type_object)) {
+					continue;
+				}
+
+				if (largest == segments.end() || it->value->size() > largest->value->size()) {
+					largest = it;
+				}
+			}
+
+			if (largest == segments.end()) {
+				break;
+			}
+
+			if (this->packed && this->isPackableArray(largest->value)) {
+				largest->isLeaf = true;
+				continue;
+			}
+
+			auto parts = this->splitSegment(*largest, target);
+			const auto index = largest - segments.begin();
+			segments.erase(largest);
+			segments.insert(segments.begin() + index, std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+		}
+
+		return segments;
+	}
+
+	// replaces a container segment by its header and up to count runs of its elements
+	std::vector<segment> splitSegment(segment& container, std::size_t count)
+	{
+		const auto* value = container.value;
+		const std::size_t size = value->size();
+		const auto runs = std::min(size, count);
+
+		std::string pending = std::move(container.literal);
+		simba::details::simba_buffer_output_adapter<std::string> pendingAdapter{ pending };
+		this->writeContainerHeader(pendingAdapter, value);
+
+		std::vector<segment> parts(runs);
+
+		if (value->getType() == simba_type_array) {
+			const auto* elements = value->getArray().data();
+
+			for (std::size_t i = 0u; i < runs; ++i) {
+				auto& part = parts[i];
+				part.firstElement = elements + size * i / runs;
+				part.lastElement = elements + size * (i + 1u) / runs;
+
+				if (part.lastElement - part.firstElement == 1) {
+					part.value = part.firstElement; // a single element can be split further
+				}
+			}
+		}
+		else {
+			auto it = value->getObject().begin();
+
+			for (std::size_t i = 0u; i < runs; ++i) {
+				auto& part = parts[i];
+				part.isObjectRange = true;
+				part.firstPair = it;
+				std::advance(it, size * (i + 1u) / runs - size * i / runs);
+				part.lastPair = it;
+			}
+		}
+
+		parts.front().literal = std::move(pending);
+
+		for (auto& part : parts) {
+			if (part.isObjectRange && std::next(part.firstPair) == part.lastPair) {
+				simba::details::simba_buffer_output_adapter<std::string> keyAdapter{ part.literal };
+				this->writeKey(keyAdapter, part.firstPair->first);
+				part.value = &part.firstPair->second;
+				part.isObjectRange = false;
+			}
+		}
+
+		return parts;
+	}
+
+	// encodes segments [first, last) in parallel, each into its own slice of out
+	void encodeSegments(const std::vector<segment>& segments, std::size_t first, std::size_t last, char* out)
+	{
+		std::vector<std::uint64_t> offsets(last - first, 0u);
+		for (auto i = first + 1u; i < last; ++i) {
+			offsets[i - first] = offsets[i - first - 1u] + segments[i - 1u].size;
+		}
+
+		simba::details::parallel_for(this->threads, first, last, [this, &segments, &offsets, first, out](std::size_t i) {
+			simba::details::simba_pointer_output_adapter adapter{ out + offsets[i - first], static_cast<std::size_t>(segments[i].size) };
+			this->encodeSegment(adapter, segments[i]);
+		});
+	}
+
+	template<typename Adapter>
+	void encodeSegment(Adapter& stream, const segment& part)
+	{
+		if (!part.literal.empty()) {
+			stream.write(part.literal.data(), static_cast<std::streamsize>(part.literal.size()));
+		}
+
+		if (part.value != nullptr) {
+			this->writeElement(stream, part.value);
+		}
+		else if (part.isObjectRange) {
+			this->writeObjectPairs(stream, part.firstPair, part.lastPair);
+		}
+		else {
+			this->writeArrayElements(stream, part.firstElement, part.lastElement);
+		}
+	}
+
+	template<typename Adapter>
+	void writeHeader(Adapter& stream)
+	{
+		stream.write(simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN);
+
+		auto endianess = simba::details::getEndianess();
+
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			if (this->compressed || this->deduplicated || this->packed || this->indexed) {
+				throw std::exception("Compression, string tables, packed integers and indexes require simba format v2");
+			}
+
+			stream.write(reinterpret_cast<const char*>(&endianess), sizeof(endianess));
+			return;
+		}
+
+		if (this->compressed && this->indexed) {
+			throw std::exception("An index can't be combined with compression");
+		}
+
+		// v1 readers only know the plain endianess byte, the high bit announces the version and feature flags
+		const std::uint8_t flags = (this->compressed ? simba::details::SIMBA_FLAG_COMPRESSED : 0u)
+			| (this->deduplicated ? simba::details::SIMBA_FLAG_STRING_TABLE : 0u)
+			| (this->indexed ? simba::details::SIMBA_FLAG_INDEX : 0u);
+		const std::uint8_t extended[] = { static_cast<std::uint8_t>(endianess | simba::details::SIMBA_HEADER_EXTENDED), this->version, flags };
+		stream.write(reinterpret_cast<const char*>(extended), sizeof(extended));
+	}
+
+	template<typename Adapter>
+	void writeElement(Adapter& stream, const simba_value* value)
+	{
+		if constexpr (std::is_same_v<Adapter, simba::details::simba_size_output_adapter>) {
+			if (value->simbaType == simba_type_array) {
+				return this->countNode(stream, value, value->storage.arrayValue);
+			}
+			else if (value->simbaType == simba_type_object) {
+				return this->countNode(stream, value, value->storage.objectValue);
+			}
+		}
+
+		this->writeValue(stream, value);
+	}
+
+	// containers remember their size while they're shared, so sizing a tree that shares
+	// large subtrees with other values only walks the parts that aren't shared.
+	// The cached size is always the one of the default format.
+	template<typename Container>
+	void countNode(simba::details::simba_size_output_adapter& counter, const simba_value* value, const simba::details::simba_node<Container>* node)
+	{
+		const bool useCache = this->version == simba::SIMBA_FORMAT_VERSION && !this->deduplicated && !this->packed;
+		const auto cached = node->serializedSize.load(std::memory_order_relaxed);
+
+		if (useCache && cached != 0u) {
+			counter.skip(cached);
+			return;
+		}
+
+		const auto begin = counter.size();
+		this->writeValue(counter, value);
+
+		if (useCache && node->isShared()) {
+			node->serializedSize.store(counter.size() - begin, std::memory_order_relaxed);
+		}
+	}
+
+	template<typename Adapter>
+	void writeValue(Adapter& stream, const simba_value* value)
+	{
+		if (value->getType() == simba_type_typed_array) {
+			this->writeTypedArray(stream, value);
+			return;
+		}
+		else if (value->getType() == simba_type_array) {
+			if (this->packed && this->writePackedArray(stream, value)) {
+				return;
+			}
+
+			const auto& arr = value->getArray();
+
+			if constexpr (simba::details::is_offset_adapter<Adapter>::value) {
+				if (arr.size() >= simba::details::SIMBA_MIN_INDEXED_COUNT) {
+					this->writeIndexedContainer(stream, value, arr.begin(), arr.end());
+					return;
+				}
+			}
+
+			this->writeContainerHeader(stream, value);
+			this->writeArrayElements(stream, arr.data(), arr.data() + arr.size());
+			return;
+		}
+		else if (value->getType() == simba_type_object) {
+			const auto& obj = value->getObject();
+
+			if constexpr (simba::details::is_offset_adapter<Adapter>::value) {
+				if (obj.size() >= simba::details::SIMBA_MIN_INDEXED_COUNT) {
+					this->writeIndexedContainer(stream, value, obj.begin(), obj.end());
+					return;
+				}
+			}
+
+			this->writeContainerHeader(stream, value);
+			this->writeObjectPairs(stream, obj.begin(), obj.end());
+			return;
+		}
+
+		if (this->deduplicated && value->getType() == simba_type_string8 && this->writeStringReference(stream, value->get<std::string>())) {
+			return;
+		}
+
+		const bool compact = this->version != simba::SIMBA_FORMAT_V1 && this->writeCompactTag(stream, value);
+
+		if (!compact) {
+			this->writeElementType(stream, value->getType(), value->getTypeFlag());
+		}
+		else if (simba::details::hasTypeFlag(value->getType())) {
+			return; // integers are part of the tag
+		}
+
+		switch (value->getType()) {
+		case simba_type_null:
+			// dont write anything
+			break;
+		case simba_type_int8:
+			if (value->isSigned()) {
+				this->writeInteger(stream, value->get<std::int8_t>());
+			}
+			else {
+				this->writeInteger(stream, value->get<std::uint8_t>());
+			}
+			break;
+		case simba_type_int16:
+			if (value->isSigned()) {
+				this->writeInteger(stream, value->get<std::int16_t>());
+			}
+			else {
+				this->writeInteger(stream, value->get<std::uint16_t>());
+			}
+			break;
+		case simba_type_int32:
+			if (value->isSigned()) {
+				this->writeInteger(stream, value->get<std::int32_t>());
+			}
+			else {
+				this->writeInteger(stream, value->get<std::uint32_t>());
+			}
+			break;
+		case simba_type_int64:
+			if (value->isSigned()) {
+				this->writeInteger(stream, value->get<std::int64_t>());
+			}
+			else {
+				this->writeInteger(stream, value->get<std::uint64_t>());
+			}
+			break;
+		case simba_type_float:
+			this->writeFixed(stream, value->get<float>());
+			break;
+		case simba_type_double:
+			this->writeFixed(stream, value->get<double>());
+			break;
+		case simba_type_string8:
+			if (compact) {
+				stream.write(value->get<std::string>().data(), value->length());
+			}
+			else {
+				this->writeString(stream, value->get<std::string>());
+			}
+			break;
+		case simba_type_string16:
+			this->writeString(stream, value->get<std::u16string>());
+			break;
+		case simba_type_string32:
+			this->writeString(stream, value->get<std::u32string>());
+			break;
+		case simba_type_string_w:
+			this->writeString(stream, value->get<std::wstring>());
+			break;
+		}
+	}
+
+	// tag and element count of an array or object
+	template<typename Adapter>
+	void writeContainerHeader(Adapter& stream, const simba_value* value)
+	{
+		if (this->version != simba::SIMBA_FORMAT_V1 && this->writeCompactTag(stream, value)) {
+			return;
+		}
+
+		this->writeElementType(stream, value->getType(), value->getTypeFlag());
+		this->writeSize(stream, value->size());
+	}
+
+	template<typename Adapter>
+	void writeArrayElements(Adapter& stream, const simba_value* first, const simba_value* last)
+	{
+		for (; first != last; ++first) {
+			this->writeElement(stream, first);
+		}
+	}
+
+	template<typename Adapter, typename Iterator>
+	void writeObjectPairs(Adapter& stream, Iterator first, Iterator last)
+	{
+		for (; first != last; ++first) {
+			this->writeKey(stream, first->first);
+			this->writeElement(stream, &first->second);
+		}
+	}
+
+	// v2: tag, element tag (type | flag << 4), count and all elements in a single write.
+	// v1 has no typed arrays, they are written as a regular array and read back as one.
+	template<typename Adapter>
+	void writeTypedArray(Adapter& stream, const simba_value* value)
+	{
+		value->visitTypedNode([this, &stream, value](auto* node) {
+			const auto& elements = node->container;
+
+			if (this->version == simba::SIMBA_FORMAT_V1) {
+				this->writeElementType(stream, simba_type_array, simba_type_flag_signed);
+				this->writeSize(stream, elements.size());
+
+				for (const auto& element : elements) {
+					this->writeElementType(stream, value->getElementType(), value->getTypeFlag());
+					this->writeFixed(stream, element);
+				}
+				return;
+			}
+
+			using T = typename std::decay_t<decltype(elements)>::value_type;
+
+			if constexpr (std::is_integral_v<T>) {
+				const auto get = [&elements](std::size_t i) { return elements[i]; };
+
+				if (this->packed && this->writePackedIntegers<T>(stream, 0u, elements.size(), get, elements.size() * sizeof(T))) {
+					return;
+				}
+			}
+
+			const std::uint8_t tags[] = { simba_type_typed_array, static_cast<std::uint8_t>(value->getElementType() | value->getTypeFlag() << 4) };
+			stream.write(reinterpret_cast<const char*>(tags), sizeof(tags));
+			this->writeSize(stream, elements.size());
+
+			if (!elements.empty()) {
+				this->writePayload(stream, reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(elements[0]));
+			}
+		});
+	}
+
+	// at least SIMBA_MIN_PACKED_COUNT integers of a single type, packed as a typed array that is read back as an array
+	bool isPackableArray(const simba_value* value) const
+	{
+		if (value->getType() != simba_type_array || value->size() < simba::details::SIMBA_MIN_PACKED_COUNT) {
+			return false;
+		}
+
+		const auto& arr = value->getArray();
+		const auto type = arr.front().getType();
+		const auto flag = arr.front().getTypeFlag();
+
+		if (type < simba_type_int8 || type > simba_type_int64) {
+			return false;
+		}
+
+		for (const auto& element : arr) {
+			if (element.getType() != type || element.getTypeFlag() != flag) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<typename Adapter>
+	bool writePackedArray(Adapter& stream, const simba_value* value)
+	{
+		if (!this->isPackableArray(value)) {
+			return false;
+		}
+
+		const auto& arr = value->getArray();
+		bool written = false;
+
+		// the size of the elements as regular values, small ones only take their compact tag
+		simba::details::simba_size_output_adapter regular;
+		this->writeArrayElements(regular, arr.data(), arr.data() + arr.size());
+
+		simba::details::visitElementType(arr.front().getType(), arr.front().getTypeFlag(), [this, &stream, &arr, &written, &regular](auto element) {
+			using T = decltype(element);
+
+			if constexpr (std::is_integral_v<T>) {
+				const auto get = [&arr](std::size_t i) { return arr[i].template get<T>(); };
+				written = this->writePackedIntegers<T>(stream, simba::details::SIMBA_ELEMENT_AS_ARRAY, arr.size(), get, regular.size());
+			}
+		});
+
+		return written;
+	}
+
+	// Delta + frame of reference encoding: the first value and the smallest difference between neighbours
+	// as zigzag varints, then the bit width of difference - smallest and all those bit-packed, little endian.
+	// Writes nothing and returns false unless that's smaller than limit, the size of the elements otherwise.
+	template<typename T, typename Adapter, typename Get>
+	bool writePackedIntegers(Adapter& stream, std::uint8_t elementBits, std::size_t count, const Get& get, std::uint64_t limit)
+	{
+		using wide_t = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+		const auto bitsAt = [&get](std::size_t i) { return static_cast<std::uint64_t>(static_cast<wide_t>(get(i))); };
+
+		if (count == 0u) {
+			return false;
+		}
+
+		auto smallest = std::numeric_limits<std::int64_t>::max();
+		auto largest = std::numeric_limits<std::int64_t>::min();
+
+		for (std::size_t i = 1u; i < count; ++i) {
+			const auto delta = static_cast<std::int64_t>(bitsAt(i) - bitsAt(i - 1u));
+			smallest = std::min(smallest, delta);
+			largest = std::max(largest, delta);
+		}
+
+		const auto first = simba::details::zigzag(static_cast<std::int64_t>(bitsAt(0u)));
+		std::uint8_t width = 0u;
+		std::uint64_t size = simba::details::varint_length(first);
+
+		if (count > 1u) {
+			width = simba::details::bit_width(static_cast<std::uint64_t>(largest) - static_cast<std::uint64_t>(smallest));
+			size += simba::details::varint_length(simba::details::zigzag(smallest)) + 1u + ((count - 1u) * width + 7u) / 8u;
+		}
+
+		if (width > simba::details::SIMBA_MAX_PACKED_WIDTH || size + 1u >= limit) {
+			return false;
+		}
+
+		using element = simba::details::typed_element<T>;
+		const std::uint8_t tags[] = { simba_type_typed_array, static_cast<std::uint8_t>(element::type | element::flag << 4 | simba::details::SIMBA_ELEMENT_PACKED | elementBits) };
+		stream.write(reinterpret_cast<const char*>(tags), sizeof(tags));
+		this->writeSize(stream, count);
+		this->writeVarint(stream, first);
+
+		if (count == 1u) {
+			return true;
+		}
+
+		this->writeVarint(stream, simba::details::zigzag(smallest));
+		stream.write(reinterpret_cast<const char*>(&width), 1);
+
+		char buffer[256];
+		std::size_t used = 0u;
+		std::uint64_t pending = 0u;
+		unsigned pendingBits = 0u;
+
+		for (std::size_t i = 1u; i < count; ++i) {
+			// fewer than 8 bits are pending, so a field of up to 56 bits always fits
+			pending |= (bitsAt(i) - bitsAt(i - 1u) - static_cast<std::uint64_t>(smallest)) << pendingBits;
+			pendingBits += width;
+
+			for (; pendingBits >= 8u; pendingBits -= 8u, pending >>= 8) {
+				buffer[used++] = static_cast<char>(pending);
+
+				if (used == sizeof(buffer)) {
+					stream.write(buffer, static_cast<std::streamsize>(used));
+					used = 0u;
+				}
+			}
+		}
+
+		if (pendingBits != 0u) {
+			buffer[used++] = static_cast<char>(pending);
+		}
+
+		stream.write(buffer, static_cast<std::streamsize>(used));
+		return true;
+	}
+
+	// small non-negative integers, short strings and small containers store their value,
+	// length or count in the tag byte (v2 only), returns false when the regular tag is needed
+	template<typename Adapter>
+	bool writeCompactTag(Adapter& stream, const simba_value* value)
+	{
+		const auto type = value->getType();
+		std::uint8_t tag{ 0u };
+
+		if (simba::details::hasTypeFlag(type)) {
+			if (value->isSigned() && value->cast<std::int64_t>() < 0) {
+				return false;
+			}
+
+			const auto small = value->cast<std::uint64_t>();
+
+			if (type == simba_type_int32 && value->isSigned() && small < 128u) {
+				tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_FIXINT | small);
+			}
+			else if (small < 4u) {
+				tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_TINYINT | (type - simba_type_int8) << 3 | value->getTypeFlag() << 2 | small);
+			}
+			else {
+				return false;
+			}
+		}
+		else if (type == simba_type_string8 && value->length() < 32u) {
+			tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_FIXSTR | value->length());
+		}
+		else if (type == simba_type_array && value->size() < 16u) {
+			tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_FIXARRAY | value->size());
+		}
+		else if (type == simba_type_object && value->size() < 16u) {
+			tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_FIXOBJECT | value->size());
+		}
+		else {
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(&tag), 1);
+		return true;
+	}
+
+	// v1: type byte followed by the flag byte for integers
+	// v2: a single byte, the flag is stored in the high nibble
+	template<typename Adapter>
+	void writeElementType(Adapter& stream, const std::uint8_t& type, const std::uint8_t& typeFlag)
+	{
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			const auto tag = static_cast<std::uint8_t>(simba::details::hasTypeFlag(type) ? type | (typeFlag << 4) : type);
+			stream.write(reinterpret_cast<const char*>(&tag), 1);
+			return;
+		}
+
+		// Write type
+		stream.write(reinterpret_cast<const char*>(&type), 1);
+
+		if (simba::details::hasTypeFlag(type)) {
+			stream.write(reinterpret_cast<const char*>(&typeFlag), 1);
+		}
+	}
+
+	// v1: always a 4 byte unsigned integer, v2: LEB128 varint
+	template<typename Adapter>
+	void writeSize(Adapter& stream, std::uint64_t size)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			static_assert(sizeof(std::uint32_t) == 4, "Invalid integer size type");
+			const auto size32 = static_cast<std::uint32_t>(size);
+			stream.write(reinterpret_cast<const char*>(&size32), sizeof(std::uint32_t));
+		}
+		else {
+			this->writeVarint(stream, size);
+		}
+	}
+
+	template<typename Adapter>
+	void writeVarint(Adapter& stream, std::uint64_t value)
+	{
+		char buffer[10];
+		std::size_t len = 0u;
+
+		while (value >= 0x80u) {
+			buffer[len++] = static_cast<char>(value | 0x80u);
+			value >>= 7;
+		}
+
+		buffer[len++] = static_cast<char>(value);
+		stream.write(buffer, static_cast<std::streamsize>(len));
+	}
+
+	// v1 prefixes every scalar with its size, v2 knows the size from the type
+	template<typename T, typename Adapter>
+	void writeFixed(Adapter& stream, const T& value)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			this->writeSize(stream, sizeof(T));
+		}
+
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// v2 stores integers wider than a byte as varints (zigzag encoded when signed),
+	// small values take a single byte no matter the declared width
+	template<typename T, typename Adapter>
+	void writeInteger(Adapter& stream, const T& value)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1 || sizeof(T) == 1) {
+			this->writeFixed(stream, value);
+		}
+		else if constexpr (std::is_signed_v<T>) {
+			this->writeVarint(stream, simba::details::zigzag(value));
+		}
+		else {
+			this->writeVarint(stream, value);
+		}
+	}
+
+	// v1: char size, length, characters
+	// v2: length, characters. Only wide strings keep the char size since it depends on the platform
+	template<typename CharType, typename Adapter>
+	void writeString(Adapter& stream, const std::basic_string<CharType>& str)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1 || std::is_same_v<CharType, wchar_t>) {
+			this->writeSize(stream, sizeof(CharType));
+		}
+
+		this->writeSize(stream, str.length());
+		this->writePayload(stream, reinterpret_cast<const char*>(str.data()), str.length() * sizeof(CharType));
+	}
+
+	// bytes that live in the value being serialized, gathering adapters reference them instead of copying
+	template<typename Adapter>
+	void writePayload(Adapter& stream, const char* data, std::size_t len)
+	{
+		if constexpr (simba::details::has_write_reference<Adapter>::value) {
+			stream.writeReference(data, len);
+		}
+		else {
+			stream.write(data, static_cast<std::streamsize>(len));
+		}
+	}
+
+	// keys are always strings, v2 stores them without a type tag.
+	// With a string table the length is shifted left by one, a set low bit means table index instead.
+	template<typename Adapter>
+	void writeKey(Adapter& stream, const simba_key& key)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			this->writeElementType(stream, simba_type_string8, simba_type_flag_signed);
+		}
+		else if (this->deduplicated) {
+			const auto it = this->keyIndex.find(&key.string());
+
+			if (it != this->keyIndex.end()) {
+				this->writeVarint(stream, std::uint64_t{ it->second } << 1 | 1u);
+			}
+			else {
+				this->writeVarint(stream, std::uint64_t{ key.length() } << 1);
+				stream.write(key.data(), static_cast<std::streamsize>(key.length()));
+			}
+			return;
+		}
+
+		this->writeString(stream, key.string());
+	}
+
+	// returns false if str isn't in the string table
+	template<typename Adapter>
+	bool writeStringReference(Adapter& stream, std::string_view str)
+	{
+		const auto it = this->stringIndex.find(str);
+
+		if (it == this->stringIndex.end()) {
+			return false;
+		}
+
+		stream.write(reinterpret_cast<const char*>(&simba::details::SIMBA_TAG_STRINGREF), 1);
+		this->writeVarint(stream, it->second);
+		return true;
+	}
+
+	// records where the container and each of its children (a pair starts with its key) begin, and where it ends
+	template<typename Adapter, typename Iterator>
+	void writeIndexedContainer(simba::details::simba_offset_output_adapter<Adapter>& stream, const simba_value* value, Iterator first, Iterator last)
+	{
+		const auto entry = this->indexEntries.size();
+		this->indexEntries.emplace_back();
+		this->indexEntries[entry].offset = stream.offset();
+		this->indexEntries[entry].children.reserve(value->size());
+
+		this->writeContainerHeader(stream, value);
+
+		for (; first != last; ++first) {
+			this->indexEntries[entry].children.push_back(stream.offset());
+
+			if constexpr (std::is_same_v<std::decay_t<decltype(*first)>, simba_value>) {
+				this->writeElement(stream, &*first);
+			}
+			else {
+				this->writeKey(stream, first->first);
+				this->writeElement(stream, &first->second);
+			}
+		}
+
+		this->indexEntries[entry].end = stream.offset();
+	}
+
+	// Index section, after the value: offset width (4 or 8), varint number of containers, then for every container
+	// in the order they start its offset, the offset past its end and the offset of its table, followed by the
+	// tables (one offset per child, pairs are in key order). Offsets are fixed width in the byte order of the
+	// header and count from its first byte. The last 8 bytes of the output are the offset of the section.
+	template<typename Adapter>
+	void writeIndex(simba::details::simba_offset_output_adapter<Adapter>& stream)
+	{
+		const auto start = stream.offset();
+		const auto directory = start + 1u + simba::details::varint_length(this->indexEntries.size());
+
+		std::uint64_t children = 0u;
+		for (const auto& entry : this->indexEntries) {
+			children += entry.children.size();
+		}
+
+		const auto entries = static_cast<std::uint64_t>(this->indexEntries.size());
+		const std::uint8_t width = directory + (entries * 3u + children) * 4u <= std::numeric_limits<std::uint32_t>::max() ? 4u : 8u;
+
+		stream.write(reinterpret_cast<const char*>(&width), 1);
+		this->writeVarint(stream, entries);
+
+		auto table = directory + entries * 3u * width;
+
+		for (const auto& entry : this->indexEntries) {
+			this->writeOffset(stream, entry.offset, width);
+			this->writeOffset(stream, entry.end, width);
+			this->writeOffset(stream, table, width);
+			table += entry.children.size() * width;
+		}
+
+		for (const auto& entry : this->indexEntries) {
+			for (const auto offset : entry.children) {
+				this->writeOffset(stream, offset, width);
+			}
+		}
+
+		stream.write(reinterpret_cast<const char*>(&start), sizeof(start));
+	}
+
+	template<typename Adapter>
+	void writeOffset(Adapter& stream, std::uint64_t offset, std::uint8_t width)
+	{
+		if (width == sizeof(std::uint32_t)) {
+			const auto offset32 = static_cast<std::uint32_t>(offset);
+			stream.write(reinterpret_cast<const char*>(&offset32), sizeof(offset32));
+		}
+		else {
+			stream.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+		}
+	}
+
+	// count, then every entry as length and characters
+	template<typename Adapter>
+	void writeStringTable(Adapter& stream)
+	{
+		this->writeVarint(stream, this->stringTable.size());
+
+		for (const auto& str : this->stringTable) {
+			this->writeVarint(stream, str.length());
+			stream.write(str.data(), static_cast<std::streamsize>(str.length()));
+		}
+	}
+
+	// The table holds the strings (values and keys) that occur more than once, in the order they are first written.
+	// Keys are interned, so they are counted and looked up by their address instead of hashing the characters.
+	void buildStringTable()
+	{
+		string_counts counts;
+		this->countStrings(this->value, counts);
+
+		for (const auto& str : counts.order) {
+			auto total = 0u;
+
+			if (const auto value = counts.values.find(str); value != counts.values.end()) {
+				total += value->second;
+			}
+
+			const auto* key = counts.seen[str];
+			if (key != nullptr) {
+				total += counts.keys[key];
+			}
+
+			if (total < 2u || str.length() < simba::details::SIMBA_MIN_TABLE_STRING) {
+				continue;
+			}
+
+			const auto index = static_cast<std::uint32_t>(this->stringTable.size());
+			this->stringTable.push_back(str);
+			this->stringIndex.emplace(str, index);
+
+			if (key != nullptr) {
+				this->keyIndex.emplace(key, index);
+			}
+		}
+	}
+
+	void countStrings(const simba_value* value, string_counts& counts)
+	{
+		switch (value->getType()) {
+		case simba_type_string8:
+			if (counts.values[value->get<std::string>()]++ == 0u && counts.seen.try_emplace(value->get<std::string>(), nullptr).second) {
+				counts.order.push_back(value->get<std::string>());
+			}
+			break;
+		case simba_type_array:
+			for (const auto& element : value->getArray()) {
+				this->countStrings(&element, counts);
+			}
+			break;
+		case simba_type_object:
+			for (const auto& pair : value->getObject()) {
+				if (counts.keys[&pair.first.string()]++ == 0u) {
+					// the same characters may have been seen as a value before
+					const auto seen = counts.seen.try_emplace(pair.first, &pair.first.string());
+					seen.first->second = &pair.first.string();
+
+					if (seen.second) {
+						counts.order.push_back(pair.first);
+					}
+				}
+
+				this->countStrings(&pair.second, counts);
+			}
+			break;
+		}
+	}
+
+private:
+	const simba_value* value = nullptr;
+	std::uint8_t version = simba::SIMBA_FORMAT_VERSION;
+	std::size_t threads = 1u;
+	bool compressed = false;
+	bool deduplicated = false;
+	bool packed = false;
+	bool indexed = false;
+	std::vector<index_entry> indexEntries;
+	std::vector<std::string_view> stringTable;
+	std::unordered_map<std::string_view, std::uint32_t> stringIndex;
+	std::unordered_map<const std::string*, std::uint32_t> keyIndex;
+};
+
+class simba::details::simba_deserializer
+{
+public:
+	using adapter_t = simba::details::simba_input_adapter;
+
+public:
+	simba_deserializer(simba_value* value, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: value(value), resource(resource)
+	{}
+
+	// goes through the virtual simba_input_adapter interface
+	void from(adapter_t& adapter)
+	{
+		this->readFrom(adapter);
+	}
+
+	// any type with read(char*, std::streamsize), the reads are dispatched statically
+	// so the compiler can inline them into the deserializer
+	template<typename Adapter, typename = std::enable_if_t<simba::details::is_input_adapter<Adapter>::value>>
+	void from(Adapter& adapter)
+	{
+		this->readFrom(adapter);
+	}
+
+	void from(const std::string& filename)
+	{
+#if defined(SIMBA_HAS_MMAP)
+		simba::details::simba_mmap_input_adapter adapter{ filename };
+		this->from(adapter);
+#else
+		std::ifstream file{ filename, std::ios::binary };
+		simba::details::simba_stream_input_adapter adapter{ file };
+		this->from(adapter);
+#endif
+	}
+
+	void fromString(const std::string& input)
+	{
+		this->fromBuffer(input.data(), input.length());
+	}
+
+	// the buffer is only read during the call, no copy is made
+	void fromBuffer(const char* data, std::size_t length)
+	{
+		simba::details::simba_memory_input_adapter adapter{ data, length };
+		this->from(adapter);
+	}
+
+	void fromBuffer(const std::vector<char>& buffer)
+	{
+		this->fromBuffer(buffer.data(), buffer.size());
+	}
+
+private:
+	template<typename Adapter>
+	void readFrom(Adapter& adapter)
+	{
+		this->readHeader(adapter);
+
+		if (this->compressed) {
+			simba::details::simba_decompress_input_adapter<Adapter> blocks{ adapter };
+			this->readBody(blocks);
+		}
+		else {
+			this->readBody(adapter);
+		}
+	}
+
+	template<typename Adapter>
+	void readBody(Adapter& adapter)
+	{
+		if (this->deduplicated) {
+			this->readStringTable(adapter);
+		}
+
+		this->readElement(adapter, this->value);
+	}
+
+	// the table is read once, entries referenced as keys are interned the first time they are used
+	template<typename Adapter>
+	void readStringTable(Adapter& adapter)
+	{
+		const auto count = this->getSize(adapter);
+
+		this->strings.clear();
+		this->stringKeys.clear();
+
+		for (auto i = 0u; i < count; ++i) {
+			std::string str;
+			str.resize(this->getSize(adapter));
+			adapter.read(str.data(), static_cast<std::streamsize>(str.length()));
+
+			this->strings.push_back(std::move(str));
+		}
+
+		this->stringKeys.resize(this->strings.size());
+	}
+
+	template<typename Adapter>
+	std::uint32_t readStringIndex(Adapter& adapter)
+	{
+		const auto index = this->readVarint(adapter);
+
+		if (index >= this->strings.size()) {
+			throw std::exception("Invalid string table index, corrupted file?");
+		}
+
+		return static_cast<std::uint32_t>(index);
+	}
+
+	template<typename Adapter>
+	void readHeader(Adapter& adapter)
+	{
+		char header[5];
+
+		adapter.read(header, 5);
+
+		if (memcmp(header, simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN)) {
+			throw std::exception("Not a valid simba header!");
+		}
+
+		std::uint8_t endianess{ 0u };
+
+		adapter.read(reinterpret_cast<char*>(&endianess), 1);
+
+		if (endianess & simba::details::SIMBA_HEADER_EXTENDED) {
+			std::uint8_t extended[2]{ 0u, 0u }; // version, feature flags
+			adapter.read(reinterpret_cast<char*>(extended), sizeof(extended));
+
+			if (extended[0] <= simba::SIMBA_FORMAT_V1 || extended[0] > simba::SIMBA_FORMAT_VERSION) {
+				throw std::exception("Unsupported simba format version");
+			}
+
+			if (extended[1] & ~simba::details::SIMBA_SUPPORTED_FLAGS) {
+				throw std::exception("Simba file uses unsupported features");
+			}
+
+			this->version = extended[0];
+			this->compressed = (extended[1] & simba::details::SIMBA_FLAG_COMPRESSED) != 0u;
+			this->deduplicated = (extended[1] & simba::details::SIMBA_FLAG_STRING_TABLE) != 0u;
+			endianess &= ~simba::details::SIMBA_HEADER_EXTENDED;
+		}
+		else {
+			this->version = simba::SIMBA_FORMAT_V1;
+			this->compressed = false;
+			this->deduplicated = false;
+		}
+
+		if (endianess != simba::details::getEndianess()) {
+			this->needSwapEndianess = true;
+		}
+	}
+
+	template<typename Adapter>
+	std::pair<std::uint8_t, std::uint8_t> readElementType(Adapter& adapter)
+	{
+		std::uint8_t tag{ 0u };
+		adapter.read(reinterpret_cast<char*>(&tag), 1);
+
+		return this->readElementType(adapter, tag);
+	}
+
+	template<typename Adapter>
+	std::pair<std::uint8_t, std::uint8_t> readElementType(Adapter& adapter, std::uint8_t tag)
+	{
+		std::pair<std::uint8_t, std::uint8_t> result{ tag, 0u };
+
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			result.second = result.first >> 4;
+			result.first &= 0x0Fu;
+		}
+		else if (simba::details::hasTypeFlag(result.first)) {
+			adapter.read(reinterpret_cast<char*>(&result.second), 1);
+		}
+
+		return result;
+	}
+
+	template<typename Adapter>
+	void readElement(Adapter& adapter, simba_value* value)
+	{
+		std::uint8_t tag{ 0u };
+		adapter.read(reinterpret_cast<char*>(&tag), 1);
+
+		if (this->version != simba::SIMBA_FORMAT_V1 && tag >= simba::details::SIMBA_TAG_TINYINT) {
+			this->readCompact(adapter, value, tag);
+			return;
+		}
+
+		if (tag == simba::details::SIMBA_TAG_STRINGREF && this->deduplicated) {
+			*value = this->strings[this->readStringIndex(adapter)];
+			return;
+		}
+
+		auto typeInfo = this->readElementType(adapter, tag);
+
+		switch (typeInfo.first) {
+		case simba_type_null:
+			*value = nullptr;
+			break;
+		case simba_type_int8:
+			if (typeInfo.second == simba_type_flag_signed) {
+				*value = this->readInteger<std::int8_t>(adapter);
+			}
+			else {
+				*value = this->readInteger<std::uint8_t>(adapter);
+			}
+			break;
+		case simba_type_int16:
+			if (typeInfo.second == simba_type_flag_signed) {
+				*value = this->readInteger<std::int16_t>(adapter);
+			}
+			else {
+				*value = this->readInteger<std::uint16_t>(adapter);
+			}
+			break;
+		case simba_type_int32:
+			if (typeInfo.second == simba_type_flag_signed) {
+				*value = this->readInteger<std::int32_t>(adapter);
+			}
+			else {
+				*value = this->readInteger<std::uint32_t>(adapter);
+			}
+			break;
+		case simba_type_int64:
+			if (typeInfo.second == simba_type_flag_signed) {
+				*value = this->readInteger<std::int64_t>(adapter);
+			}
+			else {
+				*value = this->readInteger<std::uint64_t>(adapter);
+			}
+			break;
+		case simba_type_float:
+			*value = this->readFixed<float>(adapter);
+			break;
+		case simba_type_double:
+			*value = this->readFixed<double>(adapter);
+			break;
+		case simba_type_object:
+			*value = simba_value::simba_object_type(this->resource);
+			this->readObject(adapter, value, this->getSize(adapter));
+			break;
+		case simba_type_array:
+			*value = simba_value::simba_array_type(this->resource);
+			this->readArray(adapter, value, this->getSize(adapter));
+			break;
+		case simba_type_string8:
+			this->readString<char>(adapter, value);
+			break;
+		case simba_type_string16:
+			this->readString<char16_t>(adapter, value);
+			break;
+		case simba_type_string32:
+			this->readString<char32_t>(adapter, value);
+			break;
+		case simba_type_string_w:
+			this->readString<wchar_t>(adapter, value);
+			break;
+		case simba_type_typed_array:
+			this->readTypedArray(adapter, value);
+			break;
+
+		default:
+			throw std::exception("Unknown simba_value type read, corrupted file?");
+			break;
+		}
+	}
+
+	// v2 tags that carry the value, length or count themselves
+	template<typename Adapter>
+	void readCompact(Adapter& adapter, simba_value* value, std::uint8_t tag)
+	{
+		if (tag >= simba::details::SIMBA_TAG_FIXINT) {
+			*value = static_cast<std::int32_t>(tag & 0x7Fu);
+		}
+		else if (tag >= simba::details::SIMBA_TAG_FIXOBJECT) {
+			*value = simba_value::simba_object_type(this->resource);
+			this->readObject(adapter, value, tag & 0x0Fu);
+		}
+		else if (tag >= simba::details::SIMBA_TAG_FIXARRAY) {
+			*value = simba_value::simba_array_type(this->resource);
+			this->readArray(adapter, value, tag & 0x0Fu);
+		}
+		else if (tag >= simba::details::SIMBA_TAG_FIXSTR) {
+			this->readChars<char>(adapter, value, tag & 0x1Fu);
+		}
+		else {
+			const auto small = tag & 0x03u;
+			const bool isSigned = !(tag & 0x04u);
+
+			switch (simba_type_int8 + ((tag >> 3) & 0x03u)) {
+			case simba_type_int8:
+				*value = isSigned ? simba_value(static_cast<std::int8_t>(small)) : simba_value(static_cast<std::uint8_t>(small));
+				break;
+			case simba_type_int16:
+				*value = isSigned ? simba_value(static_cast<std::int16_t>(small)) : simba_value(static_cast<std::uint16_t>(small));
+				break;
+			case simba_type_int32:
+				*value = isSigned ? simba_value(static_cast<std::int32_t>(small)) : simba_value(static_cast<std::uint32_t>(small));
+				break;
+			case simba_type_int64:
+				*value = isSigned ? simba_value(static_cast<std::int64_t>(small)) : simba_value(static_cast<std::uint64_t>(small));
+				break;
+			}
+		}
+	}
+
+	// the elements are read with a single call straight into the vector's storage
+	template<typename Adapter>
+	void readTypedArray(Adapter& adapter, simba_value* value)
+	{
+		std::uint8_t elementTag{ 0u };
+		adapter.read(reinterpret_cast<char*>(&elementTag), 1);
+
+		const auto count = this->getSize(adapter);
+		const bool packed = (elementTag & simba::details::SIMBA_ELEMENT_PACKED) != 0u;
+		const bool asArray = (elementTag & simba::details::SIMBA_ELEMENT_AS_ARRAY) != 0u;
+
+		if ((elementTag & 0x20u) || (asArray && !packed)) {
+			throw std::exception("Unknown typed array element type, corrupted file?");
+		}
+
+		const bool supported = simba::details::visitElementType(elementTag & 0x0Fu, (elementTag >> 4) & 0x01u, [this, &adapter, value, count, packed, asArray](auto element) {
+			using T = decltype(element);
+
+			if (packed) {
+				if constexpr (std::is_integral_v<T>) {
+					this->readPackedArray<T>(adapter, value, count, asArray);
+					return;
+				}
+
+				throw std::exception("Packed typed array of floating point values, corrupted file?");
+			}
+
+			simba_value::simba_typed_array_type<T> elements(count, this->resource);
+
+			if (count != 0u) {
+				adapter.read(reinterpret_cast<char*>(elements.data()), static_cast<std::streamsize>(count * sizeof(T)));
+			}
+
+			if (this->needSwapEndianess) {
+				simba::details::swap_buffer(elements.data(), elements.size());
+			}
+
+			*value = std::move(elements);
+		});
+
+		if (!supported) {
+			throw std::exception("Unknown typed array element type, corrupted file?");
+		}
+	}
+
+	template<typename T, typename Adapter>
+	void readPackedArray(Adapter& adapter, simba_value* value, std::uint32_t count, bool asArray)
+	{
+		if (asArray) {
+			this->unpacked.resize(count);
+			this->readPackedIntegers(adapter, this->unpacked.data(), count);
+
+			*value = simba_value::simba_array_type(this->resource);
+			auto& arr = value->getArray();
+			arr.resize(count);
+
+			for (auto i = 0u; i < count; ++i) {
+				arr[i] = static_cast<T>(this->unpacked[i]);
+			}
+			return;
+		}
+
+		simba_value::simba_typed_array_type<T> elements(count, this->resource);
+
+		if constexpr (sizeof(T) == sizeof(std::uint64_t)) {
+			this->readPackedIntegers(adapter, reinterpret_cast<std::uint64_t*>(elements.data()), count);
+		}
+		else {
+			this->unpacked.resize(count);
+			this->readPackedIntegers(adapter, this->unpacked.data(), count);
+			std::transform(this->unpacked.begin(), this->unpacked.end(), elements.begin(), [](std::uint64_t bits) { return static_cast<T>(bits); });
+		}
+
+		*value = std::move(elements);
+	}
+
+	// see simba_serializer::writePackedIntegers, values come out as their 64 bit pattern
+	template<typename Adapter>
+	void readPackedIntegers(Adapter& adapter, std::uint64_t* out, std::uint32_t count)
+	{
+		if (count == 0u) {
+			return;
+		}
+
+		out[0] = static_cast<std::uint64_t>(simba::details::unzigzag(this->readVarint(adapter)));
+
+		if (count == 1u) {
+			return;
+		}
+
+		const auto reference = static_cast<std::uint64_t>(simba::details::unzigzag(this->readVarint(adapter)));
+
+		std::uint8_t width{ 0u };
+		adapter.read(reinterpret_cast<char*>(&width), 1);
+
+		if (width > simba::details::SIMBA_MAX_PACKED_WIDTH) {
+			throw std::exception("Invalid packed integer width, corrupted file?");
+		}
+
+		// zeroed slack so the decoder can always load 8 bytes at once
+		const auto bytes = (static_cast<std::size_t>(count - 1u) * width + 7u) / 8u;
+		this->packedBuffer.assign(bytes + sizeof(std::uint64_t), 0u);
+		adapter.read(reinterpret_cast<char*>(this->packedBuffer.data()), static_cast<std::streamsize>(bytes));
+
+		simba::details::unpack_deltas(this->packedBuffer.data(), count - 1u, width, out[0], reference, out + 1);
+	}
+
+	template<typename Adapter>
+	void readObject(Adapter& adapter, simba_value* value, std::uint32_t objSize)
+	{
+		simba::details::reserve(value->getObject(), objSize);
+
+		for (auto i = 0u; i < objSize; ++i) {
+			simba_value element;
+
+			auto key = this->readKey(adapter);
+			this->readElement(adapter, &element);
+
+			value->getObject().insert_or_assign(std::move(key), std::move(element));
+		}
+	}
+
+	// keys are read into a reused buffer and interned, a key that was seen before costs no allocation
+	// and no lock, it's copied from the keys this deserializer already acquired
+	template<typename Adapter>
+	simba_key readKey(Adapter& adapter)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			auto typeInfo = this->readElementType(adapter);
+
+			if (typeInfo.first != simba_type_string8) {
+				throw std::exception("Object key isn't a string, corrupted file?");
+			}
+
+			if (this->getSize(adapter) != sizeof(char)) {
+				throw std::exception("Object key isn't a string, corrupted file?");
+			}
+		}
+
+		else if (this->deduplicated) {
+			const auto entry = this->readVarint(adapter);
+
+			if (entry & 1u) {
+				const auto index = entry >> 1;
+
+				if (index >= this->strings.size()) {
+					throw std::exception("Invalid string table index, corrupted file?");
+				}
+
+				auto& key = this->stringKeys[static_cast<std::size_t>(index)];
+
+				if (!key) {
+					key.emplace(this->strings[static_cast<std::size_t>(index)]);
+				}
+
+				return *key;
+			}
+
+			if ((entry >> 1) > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::exception("Stored size is too large, corrupted file?");
+			}
+
+			this->keyBuffer.resize(static_cast<std::size_t>(entry >> 1));
+			adapter.read(this->keyBuffer.data(), static_cast<std::streamsize>(this->keyBuffer.size()));
+			return this->internKey(this->keyBuffer);
+		}
+
+		auto strLen = this->getSize(adapter);
+
+		this->keyBuffer.resize(strLen);
+		adapter.read(this->keyBuffer.data(), strLen);
+
+		return this->internKey(this->keyBuffer);
+	}
+
+	// the cache is keyed by the pooled strings, which stay alive as long as the cache holds their simba_key
+	simba_key internKey(std::string_view key)
+	{
+		if (const auto it = this->keys.find(key); it != this->keys.end()) {
+			return it->second;
+		}
+
+		simba_key pooled{ key };
+
+		if (this->keys.size() < simba::details::SIMBA_KEY_CACHE_SIZE) {
+			const std::string_view str = pooled;
+			this->keys.emplace(str, pooled);
+		}
+
+		return pooled;
+	}
+
+	template<typename Adapter>
+	void readArray(Adapter& adapter, simba_value* value, std::uint32_t arrSize)
+	{
+		auto& arr = value->getArray();
+		arr.resize(arrSize);
+
+		for (auto i = 0u; i < arrSize; ++i) {
+			simba_value element;
+
+			this->readElement(adapter, &element);
+
+			arr[i] = std::move(element);
+		}
+	}
+
+	template<typename CharType, typename Adapter>
+	void readString(Adapter& adapter, simba_value* value)
+	{
+		std::uint32_t strCharSize = sizeof(CharType);
+
+		if (this->version == simba::SIMBA_FORMAT_V1 || std::is_same_v<CharType, wchar_t>) {
+			strCharSize = this->getSize(adapter);
+		}
+
+		if (strCharSize != sizeof(CharType)) {
+			throw std::exception("Stored character size doesn't match this platform");
+		}
+
+		this->readChars<CharType>(adapter, value, this->getSize(adapter));
+	}
+
+	template<typename CharType, typename Adapter>
+	void readChars(Adapter& adapter, simba_value* value, std::uint32_t strLen)
+	{
+		std::basic_string<CharType> str;
+		str.resize(strLen);
+
+		adapter.read(reinterpret_cast<char*>(str.data()), sizeof(CharType) * strLen);
+
+		if (this->needSwapEndianess) {
+			simba::details::swap_buffer(str.data(), str.length());
+		}
+
+		// Assign str
+		*value = std::move(str);
+	}
+
+	// v1: 4 byte unsigned integer, v2: LEB128 varint
+	template<typename Adapter>
+	std::uint32_t getSize(Adapter& adapter)
+	{
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			const auto sz = this->readVarint(adapter);
+
+			if (sz > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::exception("Stored size is too large, corrupted file?");
+			}
+
+			return static_cast<std::uint32_t>(sz);
+		}
+
+		static_assert(sizeof(std::uint32_t) == 4, "Invalid integer size type");
+		std::uint32_t sz{ 0u };
+		adapter.read(reinterpret_cast<char*>(&sz), sizeof(std::uint32_t));
+
+		if (this->needSwapEndianess) {
+			sz = simba::details::swap_uint32(sz);
+		}
+
+		return sz;
+	}
+
+	template<typename Adapter>
+	std::uint64_t readVarint(Adapter& adapter)
+	{
+		std::uint64_t result{ 0u };
+
+		for (auto shift = 0u; shift < 64u; shift += 7u) {
+			std::uint8_t byte{ 0u };
+			adapter.read(reinterpret_cast<char*>(&byte), 1);
+
+			result |= static_cast<std::uint64_t>(byte & 0x7Fu) << shift;
+
+			if (!(byte & 0x80u)) {
+				return result;
+			}
+		}
+
+		throw std::exception("Invalid varint, corrupted file?");
+	}
+
+	// v1 prefixes every scalar with its size, v2 knows the size from the type
+	template<typename T, typename Adapter>
+	T readFixed(Adapter& adapter)
+	{
+		T t{ 0 };
+
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			adapter.read(reinterpret_cast<char*>(&t), sizeof(T));
+		}
+		else {
+			t = this->readNextValue<T>(adapter);
+		}
+
+		if (this->needSwapEndianess) {
+			simba::details::swap_buffer(&t, 1u);
+		}
+
+		return t;
+	}
+
+	template<typename T, typename Adapter>
+	T readInteger(Adapter& adapter)
+	{
+		T t{ 0 };
+
+		if (this->version == simba::SIMBA_FORMAT_V1 || sizeof(T) == 1) {
+			t = this->readFixed<T>(adapter);
+		}
+		else {
+			t = simba::details::narrow_varint<T>(this->readVarint(adapter));
+		}
+
+		return t;
+	}
+
+	template<typename T, typename Adapter>
+	T readNextValue(Adapter& adapter)
+	{
+		T t{ 0 };
+
+		auto size = this->getSize(adapter);
+
+		if (size > sizeof(T)) {
+			throw std::exception("Cannot read value into T because stored size is larger than size of T");
+		}
+
+		adapter.read(reinterpret_cast<char*>(&t), size);
+		return t;
+	}
+
+
+private:
+	simba_value* value;
+	std::pmr::memory_resource* resource;
+	std::string keyBuffer;
+	std::vector<std::string> strings;
+	std::vector<std::optional<simba_key>> stringKeys;
+	std::unordered_map<std::string_view, simba_key> keys;
+	std::vector<std::uint64_t> unpacked;
+	std::vector<unsigned char> packedBuffer;
+	std::uint8_t version = simba::SIMBA_FORMAT_VERSION;
+	bool compressed = false;
+	bool deduplicated = false;
+	bool needSwapEndianess = false;
+};
+
+// Owns a simba tree together with the arena it is allocated from.
+// Every value node, array buffer and object node decoded or created through the document
+// is carved out of a monotonic buffer, freeing them is a no-op and the memory is handed back
+// in one go when the document is cleared or destroyed. Strings longer than the small-string
+// buffer still use the global allocator so that get<std::string>() keeps returning a std::string.
+// Values (and references) taken from the tree must not outlive the document, copy them out instead.
+// Like any std::pmr::monotonic_buffer_resource the document is not thread-safe, use one per thread/request.
+class simba::simba_document
+{
+public:
+	simba_document() = default;
+
+	// initialSize is the size of the first arena block, sizing it to the expected document avoids growing
+	explicit simba_document(std::size_t initialSize)
+		: arena(initialSize)
+	{}
+
+	simba_document(const simba_document&) = delete;
+	simba_document& operator=(const simba_document&) = delete;
+
+	~simba_document()
+	{
+		this->clear();
+	}
+
+	simba_value& root() noexcept
+	{
+		return this->rootValue;
+	}
+
+	const simba_value& root() const noexcept
+	{
+		return this->rootValue;
+	}
+
+	std::pmr::memory_resource* resource() noexcept
+	{
+		return &this->arena;
+	}
+
+	// empty containers allocated inside the document, assign them into the tree
+	simba_value array()
+	{
+		return simba_value::simba_array_type(&this->arena);
+	}
+
+	simba_value object()
+	{
+		return simba_value::simba_object_type(&this->arena);
+	}
+
+	// destroy the tree and give all of the arena memory back
+	void clear()
+	{
+		this->rootValue = nullptr;
+		this->arena.release();
+	}
+
+	inline details::simba_serializer serialize() const;
+	inline details::simba_deserializer deserialize();
+
+	std::size_t serializedSize() const
+	{
+		return this->rootValue.serializedSize();
+	}
+
+private:
+	std::pmr::monotonic_buffer_resource arena;
+	simba_value rootValue;
+};
+
+struct simba::details::view_element
+{
+	std::uint8_t type = simba_type_null;   // simba_type_t, typed arrays read back as arrays are simba_type_array
+	std::uint8_t flag = 0u;                // simba_type_flag_t of integers, and of the elements of typed arrays
+	std::uint8_t elementType = 0u;         // typed arrays: type of the elements
+	bool typed = false;                    // the elements are stored contiguous or packed, not as values
+	bool packed = false;
+	std::uint8_t width = 0u;               // packed: bits per delta
+	std::uint32_t count = 0u;              // elements, pairs or characters
+	std::size_t payload = 0u;              // offset of the first child, the characters or the stored elements
+	std::size_t end = 0u;                  // offset past a scalar, string or typed array, containers have to be walked
+	std::uint64_t bits = 0u;               // scalars: the value's bit pattern, packed: the first element
+	std::uint64_t reference = 0u;          // packed: frame of reference added to every delta
+};
+
+// Read-only view over a serialized value. Nothing is decoded up front, every access decodes just the
+// elements it has to walk past, so reading a few fields of a large message costs a fraction of deserializing it.
+// Output written with index() lets it jump to elements, binary search keys and skip indexed containers instead.
+// Strings are handed out as std::string_view into the bytes, which (and the view itself) must outlive every
+// simba_view_ref taken from it. Compressed input can't be read in place and is rejected, use deserialize().
+class simba::simba_view
+{
+public:
+	simba_view(const char* data, std::size_t length)
+		: data(data), length(length)
+	{
+		this->readHeader();
+	}
+
+	explicit simba_view(std::string_view bytes)
+		: simba_view(bytes.data(), bytes.size())
+	{}
+
+	explicit simba_view(const std::vector<char>& buffer)
+		: simba_view(buffer.data(), buffer.size())
+	{}
+
+#if defined(SIMBA_HAS_MMAP)
+	// the adapter keeps the file mapped, it has to outlive the view
+	explicit simba_view(const details::simba_mmap_input_adapter& file)
+		: simba_view(file.bytes())
+	{}
+#endif
+
+	inline simba_view_ref root() const;
+
+private:
+	friend class simba_view_ref;
+
+	void readHeader()
+	{
+		std::size_t pos = 0u;
+		const char* header = this->readBytes(pos, simba::SIMBA_HEADER_LEN);
+
+		if (memcmp(header, simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN)) {
+			throw std::exception("Not a valid simba header!");
+		}
+
+		auto endianess = this->readByte(pos);
+		bool deduplicated = false;
+		bool indexed = false;
+
+		if (endianess & details::SIMBA_HEADER_EXTENDED) {
+			const auto version = this->readByte(pos);
+			const auto flags = this->readByte(pos);
+
+			if (version <= simba::SIMBA_FORMAT_V1 || version > simba::SIMBA_FORMAT_VERSION) {
+				throw std::exception("Unsupported simba format version");
+			}
+
+			if (flags & ~details::SIMBA_SUPPORTED_FLAGS) {
+				throw std::exception("Simba file uses unsupported features");
+			}
+
+			if (flags & details::SIMBA_FLAG_COMPRESSED) {
+				throw std::exception("Compressed input can't be viewed in place, deserialize it instead");
+			}
+
+			this->version = version;
+			deduplicated = (flags & details::SIMBA_FLAG_STRING_TABLE) != 0u;
+			endianess &= ~details::SIMBA_HEADER_EXTENDED;
+
+			indexed = (flags & details::SIMBA_FLAG_INDEX) != 0u;
+		}
+		else {
+			this->version = simba::SIMBA_FORMAT_V1;
+		}
+
+		this->needSwapEndianess = endianess != details::getEndianess();
+
+		if (indexed) {
+			this->readIndex();
+		}
+
+		// the table entries are the only thing decoded up front, they point into the bytes
+		if (deduplicated) {
+			const auto count = this->getSize(pos);
+
+			for (auto i = 0u; i < count; ++i) {
+				const auto strLen = this->getSize(pos);
+				this->strings.emplace_back(this->readBytes(pos, strLen), strLen);
+			}
+		}
+
+		this->deduplicated = deduplicated;
+		this->rootOffset = pos;
+	}
+
+	// see simba_serializer::writeIndex, only the location of the directory and the tables is read here
+	void readIndex()
+	{
+		std::size_t pos = this->length < sizeof(std::uint64_t) ? 0u : this->length - sizeof(std::uint64_t);
+		std::uint64_t start{ 0u };
+		std::memcpy(&start, this->readBytes(pos, sizeof(start)), sizeof(start));
+
+		if (this->needSwapEndianess) {
+			start = details::swap_uint64(start);
+		}
+
+		// the index must not reach into its own trailer
+		if (start >= this->length - sizeof(std::uint64_t)) {
+			throw std::exception("Invalid index offset, corrupted file?");
+		}
+
+		pos = static_cast<std::size_t>(start);
+		this->indexWidth = this->readByte(pos);
+
+		if (this->indexWidth != sizeof(std::uint32_t) && this->indexWidth != sizeof(std::uint64_t)) {
+			throw std::exception("Invalid index offset width, corrupted file?");
+		}
+
+		const auto entries = this->readVarint(pos);
+
+		if (entries > (this->length - sizeof(std::uint64_t) - pos) / (3u * this->indexWidth)) {
+			throw std::exception("Attempted to read past the end of the input, corrupted file?");
+		}
+
+		this->indexEntries = static_cast<std::size_t>(entries);
+		this->indexDirectory = pos;
+	}
+
+	std::size_t readOffset(std::size_t pos) const
+	{
+		std::uint64_t offset{ 0u };
+
+		if (this->indexWidth == sizeof(std::uint32_t)) {
+			std::uint32_t offset32{ 0u };
+			std::memcpy(&offset32, this->readBytes(pos, sizeof(offset32)), sizeof(offset32));
+			offset = this->needSwapEndianess ? details::swap_uint32(offset32) : offset32;
+		}
+		else {
+			std::memcpy(&offset, this->readBytes(pos, sizeof(offset)), sizeof(offset));
+			offset = this->needSwapEndianess ? details::swap_uint64(offset) : offset;
+		}
+
+		if (offset > this->length) {
+			throw std::exception("Invalid index offset, corrupted file?");
+		}
+
+		return static_cast<std::size_t>(offset);
+	}
+
+	// position of the directory entry of the container at offset, binary searched
+	std::optional<std::size_t> findIndexEntry(const details::view_element& element, std::size_t offset) const
+	{
+		if (this->indexEntries == 0u || element.typed || element.count < details::SIMBA_MIN_INDEXED_COUNT
+			|| (element.type != simba_type_array && element.type != simba_type_object)) {
+			return std::nullopt;
+		}
+
+		const std::size_t entrySize = 3u * this->indexWidth;
+		std::size_t first = 0u;
+		std::size_t last = this->indexEntries;
+
+		while (first < last) {
+			const auto middle = first + (last - first) / 2u;
+			const auto entry = this->indexDirectory + middle * entrySize;
+			const auto start = this->readOffset(entry);
+
+			if (start == offset) {
+				return entry;
+			}
+
+			if (start < offset) {
+				first = middle + 1u;
+			}
+			else {
+				last = middle;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	// offset of child index of an indexed container, entry comes from findIndexEntry
+	std::size_t indexedChild(std::size_t entry, std::uint32_t index) const
+	{
+		return this->readOffset(this->readOffset(entry + 2u * this->indexWidth) + static_cast<std::size_t>(index) * this->indexWidth);
+	}
+
+	std::uint8_t readByte(std::size_t& pos) const
+	{
+		return static_cast<std::uint8_t>(*this->readBytes(pos, 1u));
+	}
+
+	const char* readBytes(std::size_t& pos, std::size_t count) const
+	{
+		if (count > this->length - pos) {
+			throw std::exception("Attempted to read past the end of the input, corrupted file?");
+		}
+
+		const char* bytes = this->data + pos;
+		pos += count;
+		return bytes;
+	}
+
+	std::uint64_t readVarint(std::size_t& pos) const
+	{
+		std::uint64_t result{ 0u };
+
+		for (auto shift = 0u; shift < 64u; shift += 7u) {
+			const auto byte = this->readByte(pos);
+
+			result |= static_cast<std::uint64_t>(byte & 0x7Fu) << shift;
+
+			if (!(byte & 0x80u)) {
+				return result;
+			}
+		}
+
+		throw std::exception("Invalid varint, corrupted file?");
+	}
+
+	// v1: 4 byte unsigned integer, v2: LEB128 varint
+	std::uint32_t getSize(std::size_t& pos) const
+	{
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			const auto sz = this->readVarint(pos);
+
+			if (sz > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::exception("Stored size is too large, corrupted file?");
+			}
+
+			return static_cast<std::uint32_t>(sz);
+		}
+
+		std::uint32_t sz{ 0u };
+		std::memcpy(&sz, this->readBytes(pos, sizeof(sz)), sizeof(sz));
+
+		return this->needSwapEndianess ? details::swap_uint32(sz) : sz;
+	}
+
+	// v1 prefixes every scalar with its size, v2 knows the size from the type
+	template<typename T>
+	T readFixed(std::size_t& pos) const
+	{
+		T t{ 0 };
+		std::size_t size = sizeof(T);
+
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			size = this->getSize(pos);
+
+			if (size > sizeof(T)) {
+				throw std::exception("Cannot read value into T because stored size is larger than size of T");
+			}
+		}
+
+		std::memcpy(&t, this->readBytes(pos, size), size);
+
+		if (this->needSwapEndianess) {
+			details::swap_buffer(&t, 1u);
+		}
+
+		return t;
+	}
+
+	template<typename T>
+	T readInteger(std::size_t& pos) const
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1 || sizeof(T) == 1) {
+			return this->readFixed<T>(pos);
+		}
+		else {
+			return details::narrow_varint<T>(this->readVarint(pos));
+		}
+	}
+
+	// decodes the tag and header of the element at offset, scalars are decoded completely
+	details::view_element decode(std::size_t offset) const
+	{
+		details::view_element element;
+		std::size_t pos = offset;
+		std::uint8_t tag = this->readByte(pos);
+
+		if (this->version != simba::SIMBA_FORMAT_V1 && tag >= details::SIMBA_TAG_TINYINT) {
+			element.payload = pos;
+			element.end = pos;
+
+			if (tag >= details::SIMBA_TAG_FIXINT) {
+				element.type = simba_type_int32;
+				element.bits = tag & 0x7Fu;
+			}
+			else if (tag >= details::SIMBA_TAG_FIXOBJECT) {
+				element.type = simba_type_object;
+				element.count = tag & 0x0Fu;
+			}
+			else if (tag >= details::SIMBA_TAG_FIXARRAY) {
+				element.type = simba_type_array;
+				element.count = tag & 0x0Fu;
+			}
+			else if (tag >= details::SIMBA_TAG_FIXSTR) {
+				element.type = simba_type_string8;
+				element.count = tag & 0x1Fu;
+				this->readBytes(pos, element.count);
+				element.end = pos;
+			}
+			else {
+				element.type = static_cast<std::uint8_t>(simba_type_int8 + ((tag >> 3) & 0x03u));
+				element.flag = (tag & 0x04u) ? simba_type_flag_unsigned : simba_type_flag_signed;
+				element.bits = tag & 0x03u;
+			}
+
+			return element;
+		}
+
+		if (tag == details::SIMBA_TAG_STRINGREF && this->deduplicated) {
+			const auto index = this->readVarint(pos);
+
+			if (index >= this->strings.size()) {
+				throw std::exception("Invalid string table index, corrupted file?");
+			}
+
+			const auto& str = this->strings[static_cast<std::size_t>(index)];
+			element.type = simba_type_string8;
+			element.count = static_cast<std::uint32_t>(str.size());
+			element.payload = static_cast<std::size_t>(str.data() - this->data);
+			element.end = pos;
+			return element;
+		}
+
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			element.flag = tag >> 4;
+			tag &= 0x0Fu;
+		}
+		else if (details::hasTypeFlag(tag)) {
+			element.flag = this->readByte(pos);
+		}
+
+		element.type = tag;
+
+		switch (tag) {
+		case simba_type_null:
+			break;
+		case simba_type_int8:
+		case simba_type_int16:
+		case simba_type_int32:
+		case simba_type_int64:
+			details::visitElementType(tag, element.flag, [this, &element, &pos](auto value) {
+				using T = decltype(value);
+				element.bits = details::to_bits(this->readInteger<T>(pos));
+			});
+			break;
+		case simba_type_float:
+			element.bits = details::to_bits(this->readFixed<float>(pos));
+			break;
+		case simba_type_double:
+			element.bits = details::to_bits(this->readFixed<double>(pos));
+			break;
+		case simba_type_object:
+		case simba_type_array:
+			element.count = this->getSize(pos);
+			element.payload = pos;
+			return element;
+		case simba_type_string8:
+			this->decodeString<char>(pos, element);
+			break;
+		case simba_type_string16:
+			this->decodeString<char16_t>(pos, element);
+			break;
+		case simba_type_string32:
+			this->decodeString<char32_t>(pos, element);
+			break;
+		case simba_type_string_w:
+			this->decodeString<wchar_t>(pos, element);
+			break;
+		case simba_type_typed_array:
+			this->decodeTypedArray(pos, element);
+			break;
+
+		default:
+			throw std::exception("Unknown simba_value type read, corrupted file?");
+			break;
+		}
+
+		element.end = pos;
+		return element;
+	}
+
+	template<typename CharType>
+	void decodeString(std::size_t& pos, details::view_element& element) const
+	{
+		std::uint32_t strCharSize = sizeof(CharType);
+
+		if (this->version == simba::SIMBA_FORMAT_V1 || std::is_same_v<CharType, wchar_t>) {
+			strCharSize = this->getSize(pos);
+		}
+
+		if (strCharSize != sizeof(CharType)) {
+			throw std::exception("Stored character size doesn't match this platform");
+		}
+
+		element.count = this->getSize(pos);
+		element.payload = pos;
+		this->readBytes(pos, static_cast<std::size_t>(element.count) * sizeof(CharType));
+	}
+
+	// see simba_deserializer::readTypedArray and readPackedIntegers
+	void decodeTypedArray(std::size_t& pos, details::view_element& element) const
+	{
+		const auto elementTag = this->readByte(pos);
+
+		element.count = this->getSize(pos);
+		element.typed = true;
+		element.packed = (elementTag & details::SIMBA_ELEMENT_PACKED) != 0u;
+		element.elementType = elementTag & 0x0Fu;
+		element.flag = (elementTag >> 4) & 0x01u;
+
+		const bool asArray = (elementTag & details::SIMBA_ELEMENT_AS_ARRAY) != 0u;
+
+		if ((elementTag & 0x20u) || (asArray && !element.packed)) {
+			throw std::exception("Unknown typed array element type, corrupted file?");
+		}
+
+		std::size_t elementSize = 0u;
+		const bool supported = details::visitElementType(element.elementType, element.flag, [&elementSize](auto value) {
+			elementSize = sizeof(value);
+		});
+
+		if (!supported) {
+			throw std::exception("Unknown typed array element type, corrupted file?");
+		}
+
+		if (asArray) {
+			element.type = simba_type_array;
+		}
+
+		if (!element.packed) {
+			element.payload = pos;
+			this->readBytes(pos, static_cast<std::size_t>(element.count) * elementSize);
+			return;
+		}
+
+		if (element.elementType == simba_type_float || element.elementType == simba_type_double) {
+			throw std::exception("Packed typed array of floating point values, corrupted file?");
+		}
+
+		if (element.count != 0u) {
+			element.bits = static_cast<std::uint64_t>(details::unzigzag(this->readVarint(pos)));
+		}
+
+		if (element.count > 1u) {
+			element.reference = static_cast<std::uint64_t>(details::unzigzag(this->readVarint(pos)));
+			element.width = this->readByte(pos);
+
+			if (element.width > details::SIMBA_MAX_PACKED_WIDTH) {
+				throw std::exception("Invalid packed integer width, corrupted file?");
+			}
+		}
+
+		element.payload = pos;
+
+		if (element.count > 1u) {
+			this->readBytes(pos, (static_cast<std::size_t>(element.count - 1u) * element.width + 7u) / 8u);
+		}
+	}
+
+	// bit pattern of element index of a typed array, a packed one is summed from the start every time
+	std::uint64_t elementBits(const details::view_element& element, std::uint32_t index) const
+	{
+		if (element.packed) {
+			auto bits = element.bits;
+
+			for (auto i = 0u; i < index; ++i) {
+				bits += element.reference + this->packedField(element, i);
+			}
+
+			return bits;
+		}
+
+		std::uint64_t bits = 0u;
+		details::visitElementType(element.elementType, element.flag, [this, &element, index, &bits](auto value) {
+			using T = decltype(value);
+
+			std::memcpy(&value, this->data + element.payload + static_cast<std::size_t>(index) * sizeof(T), sizeof(T));
+
+			if (this->needSwapEndianess) {
+				details::swap_buffer(&value, 1u);
+			}
+
+			bits = details::to_bits(value);
+		});
+
+		return bits;
+	}
+
+	// the index-th width bit delta, fields are little endian and never read past the packed bytes
+	std::uint64_t packedField(const details::view_element& element, std::uint32_t index) const
+	{
+		if (element.width == 0u) {
+			return 0u;
+		}
+
+		const auto bit = static_cast<std::size_t>(index) * element.width;
+		const auto bytes = (static_cast<std::size_t>(element.count - 1u) * element.width + 7u) / 8u;
+		const auto first = bit / 8u;
+		const auto last = std::min(bytes, (bit + element.width + 7u) / 8u);
+
+		std::uint64_t word = 0u;
+		for (auto i = first; i < last; ++i) {
+			word |= static_cast<std::uint64_t>(static_cast<unsigned char>(this->data[element.payload + i])) << ((i - first) * 8u);
+		}
+
+		return (word >> (bit % 8u)) & (~std::uint64_t{ 0u } >> (64u - element.width));
+	}
+
+	std::string_view readKey(std::size_t& pos) const
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			const auto element = this->decode(pos);
+
+			if (element.type != simba_type_string8) {
+				throw std::exception("Object key isn't a string, corrupted file?");
+			}
+
+			pos = element.end;
+			return { this->data + element.payload, element.count };
+		}
+
+		if (this->deduplicated) {
+			const auto entry = this->readVarint(pos);
+
+			if (entry & 1u) {
+				if ((entry >> 1) >= this->strings.size()) {
+					throw std::exception("Invalid string table index, corrupted file?");
+				}
+
+				return this->strings[static_cast<std::size_t>(entry >> 1)];
+			}
+
+			const auto strLen = static_cast<std::size_t>(entry >> 1);
+			return { this->readBytes(pos, strLen), strLen };
+		}
+
+		const auto strLen = this->getSize(pos);
+		return { this->readBytes(pos, strLen), strLen };
+	}
+
+	// offset past the element at offset, arrays and objects are walked unless they're indexed
+	std::size_t skip(std::size_t offset) const
+	{
+		const auto element = this->decode(offset);
+
+		if (element.typed || (element.type != simba_type_array && element.type != simba_type_object)) {
+			return element.end;
+		}
+
+		if (const auto entry = this->findIndexEntry(element, offset)) {
+			return this->readOffset(*entry + this->indexWidth);
+		}
+
+		std::size_t pos = element.payload;
+
+		for (auto i = 0u; i < element.count; ++i) {
+			if (element.type == simba_type_object) {
+				this->readKey(pos);
+			}
+
+			pos = this->skip(pos);
+		}
+
+		return pos;
+	}
+
+private:
+	const char* data;
+	std::size_t length;
+	std::size_t rootOffset = 0u;
+	std::vector<std::string_view> strings;
+	std::size_t indexDirectory = 0u;
+	std::size_t indexEntries = 0u;
+	std::uint8_t indexWidth = 0u;
+	std::uint8_t version = simba::SIMBA_FORMAT_VERSION;
+	bool deduplicated = false;
+	bool needSwapEndianess = false;
+};
+
+// A value inside a simba_view, a position in the bytes that is only decoded when asked for something.
+// Copying it is cheap. Elements of typed arrays carry their decoded value with them.
+class simba::simba_view_ref
+{
+public:
+	class iterator;
+
+	// type, one of simba_type_t
+	std::uint8_t getType() const
+	{
+		if (this->isTypedElement()) {
+			return this->decode().elementType;
+		}
+
+		return this->decode().type;
+	}
+
+	// type flag, one of simba_type_flag_t
+	std::uint8_t getTypeFlag() const
+	{
+		return this->decode().flag;
+	}
+
+	// element type of a typed array, one of simba_type_t
+	std::uint8_t getElementType() const
+	{
+		return this->isTypedElement() ? 0u : this->decode().elementType;
+	}
+
+	// only relevant for object/map, array and typed array.
+	std::uint32_t size() const
+	{
+		if (this->isTypedElement()) {
+			return 0u;
+		}
+
+		const auto element = this->decode();
+
+		if (element.type == simba_type_array || element.type == simba_type_object || element.type == simba_type_typed_array) {
+			return element.count;
+		}
+
+		return 0u;
+	}
+
+	// only relevant for string types.
+	std::uint32_t length() const
+	{
+		if (this->isTypedElement()) {
+			return 0u;
+		}
+
+		const auto element = this->decode();
+
+		if (element.type >= simba_type_string8 && element.type <= simba_type_string_w) {
+			return element.count;
+		}
+
+		return 0u;
+	}
+
+	// elements before index are walked over and the deltas of a packed array are summed up to index, so each
+	// call is linear in index (except with an index), use the iterator to go through all elements
+	simba_view_ref operator[](std::uint32_t index) const
+	{
+		const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+		if (element.type != simba_type_array && element.type != simba_type_typed_array) {
+			throw std::exception("Cannot retrieve with integer index from non array type");
+		}
+
+		if (index >= element.count) {
+			throw std::out_of_range("Array index out of range");
+		}
+
+		if (element.typed) {
+			return { this->view, this->offset, index, this->view->elementBits(element, index) };
+		}
+
+		if (const auto entry = this->view->findIndexEntry(element, this->offset)) {
+			return { this->view, this->view->indexedChild(*entry, index) };
+		}
+
+		std::size_t pos = element.payload;
+
+		for (auto i = 0u; i < index; ++i) {
+			pos = this->view->skip(pos);
+		}
+
+		return { this->view, pos };
+	}
+
+	simba_view_ref operator[](std::string_view key) const
+	{
+		const auto found = this->find(key);
+
+		if (!found) {
+			throw std::exception("Key not found in object");
+		}
+
+		return *found;
+	}
+
+	// walks the pairs until key is found, indexed objects are binary searched (pairs are stored in key order)
+	std::optional<simba_view_ref> find(std::string_view key) const
+	{
+		const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+		if (element.type != simba_type_object) {
+			throw std::exception("Cannot retrieve string index from non object type");
+		}
+
+		if (const auto entry = this->view->findIndexEntry(element, this->offset)) {
+			std::uint32_t first = 0u;
+			std::uint32_t last = element.count;
+
+			while (first < last) {
+				const auto middle = first + (last - first) / 2u;
+				auto pos = this->view->indexedChild(*entry, middle);
+				const auto pairKey = this->view->readKey(pos);
+
+				if (pairKey == key) {
+					return simba_view_ref{ this->view, pos };
+				}
+
+				if (pairKey < key) {
+					first = middle + 1u;
+				}
+				else {
+					last = middle;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		std::size_t pos = element.payload;
+
+		for (auto i = 0u; i < element.count; ++i) {
+			if (this->view->readKey(pos) == key) {
+				return simba_view_ref{ this->view, pos };
+			}
+
+			pos = this->view->skip(pos);
+		}
+
+		return std::nullopt;
+	}
+
+	inline iterator begin() const;
+	inline iterator end() const;
+
+	// T has to be the exact stored type like simba_value::get, strings can be read as std::string_view (string8 only) or copied.
+	template<typename T>
+	T get() const
+	{
+		if constexpr (details::typed_element<T>::value) {
+			if (this->getType() != details::typed_element<T>::type || this->getTypeFlag() != details::typed_element<T>::flag) {
+				throw std::exception("Attempted to retrieve a value of a different type (use cast instead).");
+			}
+
+			return details::from_bits<T>(this->bits());
+		}
+		else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+			return T{ this->chars<char>(simba_type_string8) };
+		}
+		else if constexpr (std::is_same_v<T, std::u16string>) {
+			return this->copyChars<char16_t>(simba_type_string16);
+		}
+		else if constexpr (std::is_same_v<T, std::u32string>) {
+			return this->copyChars<char32_t>(simba_type_string32);
+		}
+		else if constexpr (std::is_same_v<T, std::wstring>) {
+			return this->copyChars<wchar_t>(simba_type_string_w);
+		}
+		else {
+			static_assert(details::typed_element<T>::value, "No possible conversion for T");
+		}
+	}
+
+	template<typename T>
+	T cast() const
+	{
+		static_assert(std::is_arithmetic_v<T>, "Cannot cast to a non-arithmetic value");
+
+		const auto bits = this->bits();
+		T result{};
+
+		if (!details::visitElementType(this->getType(), this->getTypeFlag(), [&result, bits](auto value) {
+			result = static_cast<T>(details::from_bits<decltype(value)>(bits));
+		})) {
+			throw std::exception("Unknown conversion to T");
+		}
+
+		return result;
+	}
+
+private:
+	friend class simba_view;
+
+	simba_view_ref(const simba_view* view, std::size_t offset, std::uint32_t index = noIndex, std::uint64_t elementBits = 0u)
+		: view(view), offset(offset), index(index), elementBits(elementBits)
+	{}
+
+	static constexpr std::uint32_t noIndex = std::numeric_limits<std::uint32_t>::max();
+
+	bool isTypedElement() const noexcept
+	{
+		return this->index != noIndex;
+	}
+
+	// typed array elements are decoded as the header of their array
+	details::view_element decode() const
+	{
+		return this->view->decode(this->offset);
+	}
+
+	std::uint64_t bits() const
+	{
+		return this->isTypedElement() ? this->elementBits : this->decode().bits;
+	}
+
+	template<typename CharType>
+	std::basic_string_view<CharType> chars(std::uint8_t type) const
+	{
+		const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+		if (element.type != type) {
+			throw std::exception("Attempted to retrieve a string of a different type");
+		}
+
+		static_assert(sizeof(CharType) == 1, "Only single byte characters can be viewed in place");
+		return { this->view->data + element.payload, element.count };
+	}
+
+	template<typename CharType>
+	std::basic_string<CharType> copyChars(std::uint8_t type) const
+	{
+		const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+		if (element.type != type) {
+			throw std::exception("Attempted to retrieve a string of a different type");
+		}
+
+		// the characters may be unaligned and in the other byte order
+		std::basic_string<CharType> str;
+		str.resize(element.count);
+		std::memcpy(str.data(), this->view->data + element.payload, sizeof(CharType) * element.count);
+
+		if (this->view->needSwapEndianess) {
+			details::swap_buffer(str.data(), str.length());
+		}
+
+		return str;
+	}
+
+private:
+	const simba_view* view;
+	std::size_t offset;
+	std::uint32_t index;
+	std::uint64_t elementBits;
+};
+
+// Forward iterator over the elements of an array or the pairs of an object in a simba_view.
+// Dereferencing gives the element or the pair's value, key() the key of the current pair.
+class simba::simba_view_ref::iterator
+{
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = simba_view_ref;
+	using difference_type = std::ptrdiff_t;
+	using pointer = void;
+	using reference = simba_view_ref;
+
+	simba_view_ref operator*() const
+	{
+		if (this->container.typed) {
+			return { this->view, this->offset, this->index, this->bits };
+		}
+
+		return { this->view, this->pos };
+	}
+
+	std::string_view key() const
+	{
+		return this->currentKey;
+	}
+
+	iterator& operator++()
+	{
+		if (this->container.typed) {
+			if (this->container.packed && this->index + 1u < this->container.count) {
+				this->bits += this->container.reference + this->view->packedField(this->container, this->index);
+			}
+
+			++this->index;
+
+			if (!this->container.packed && this->index < this->container.count) {
+				this->bits = this->view->elementBits(this->container, this->index);
+			}
+
+			return *this;
+		}
+
+		this->pos = this->view->skip(this->pos);
+		++this->index;
+		this->readKey();
+		return *this;
+	}
+
+	iterator operator++(int)
+	{
+		auto copy = *this;
+		++*this;
+		return copy;
+	}
+
+	bool operator==(const iterator& other) const noexcept
+	{
+		return this->view == other.view && this->offset == other.offset && this->index == other.index;
+	}
+
+	bool operator!=(const iterator& other) const noexcept
+	{
+		return !(*this == other);
+	}
+
+private:
+	friend class simba_view_ref;
+
+	iterator(const simba_view* view, std::size_t offset, const details::view_element& container, std::uint32_t index)
+		: view(view), offset(offset), container(container), pos(container.payload), index(index)
+	{
+		if (index >= container.count) {
+			return;
+		}
+
+		if (container.typed) {
+			this->bits = view->elementBits(container, 0u);
+		}
+		else {
+			this->readKey();
+		}
+	}
+
+	// moves pos from the key of the current pair to its value
+	void readKey()
+	{
+		if (this->container.type == simba_type_object && this->index < this->container.count) {
+			this->currentKey = this->view->readKey(this->pos);
+		}
+	}
+
+private:
+	const simba_view* view;
+	std::size_t offset;
+	details::view_element container;
+	std::size_t pos;
+	std::uint32_t index;
+	std::uint64_t bits = 0u;
+	std::string_view currentKey;
+};
+
+simba::simba_view_ref simba::simba_view::root() const
+{
+	return { this, this->rootOffset };
+}
+
+simba::simba_view_ref::iterator simba::simba_view_ref::begin() const
+{
+	const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+	if (element.type != simba_type_array && element.type != simba_type_object && element.type != simba_type_typed_array) {
+		throw std::exception("Cannot iterate over a value that isn't an array or object");
+	}
+
+	return { this->view, this->offset, element, 0u };
+}
+
+simba::simba_view_ref::iterator simba::simba_view_ref::end() const
+{
+	const auto element = this->isTypedElement() ? details::view_element{} : this->decode();
+
+	if (element.type != simba_type_array && element.type != simba_type_object && element.type != simba_type_typed_array) {
+		throw std::exception("Cannot iterate over a value that isn't an array or object");
+	}
+
+	return { this->view, this->offset, element, element.count };
+}
+
+// Pull parser that reads a serialized value one event at a time from an input adapter, without building it.
+// Memory use is bounded by the nesting depth, the longest key and one chunk (plus the string table of
+// deduplicated input), so files far larger than memory can be filtered or aggregated in a single pass.
+// Strings are delivered in chunks of up to SIMBA_READER_CHUNK bytes, typed arrays as arrays of scalars.
+// Compressed input is decompressed block by block, an index after the value is never read.
+template<typename Adapter>
+class simba::simba_reader
+{
+public:
+	// reads the header (and the string table) right away
+	explicit simba_reader(Adapter& input)
+		: input(&input), chunkBuffer(new char[simba::details::SIMBA_READER_CHUNK])
+	{
+		this->readHeader();
+
+		if (this->compressed) {
+			this->blocks.emplace(input);
+		}
+
+		if (this->deduplicated) {
+			this->compressed ? this->readStringTable(*this->blocks) : this->readStringTable(input);
+		}
+	}
+
+	simba_reader(const simba_reader&) = delete;
+	simba_reader& operator=(const simba_reader&) = delete;
+
+	// moves to the next event and returns it, simba_event_end_of_input once the root value has been read
+	simba_event_t next()
+	{
+		return this->compressed ? this->advance(*this->blocks) : this->advance(*this->input);
+	}
+
+	// Skips what the current event opened: after a begin event the rest of the container (the reader is then on
+	// its end event), after a key the pair's value and after a string chunk the rest of the string.
+	void skip()
+	{
+		this->compressed ? this->skipCurrent(*this->blocks) : this->skipCurrent(*this->input);
+	}
+
+	simba_event_t event() const noexcept
+	{
+		return this->current;
+	}
+
+	// type of the value, container or string of the current event, one of simba_type_t.
+	// Typed arrays begin with simba_type_typed_array and their elements are values of the element type.
+	std::uint8_t getType() const noexcept
+	{
+		return this->type;
+	}
+
+	// type flag, one of simba_type_flag_t
+	std::uint8_t getTypeFlag() const noexcept
+	{
+		return this->flag;
+	}
+
+	// element type of a typed array, on its begin event
+	std::uint8_t getElementType() const noexcept
+	{
+		return this->elementType;
+	}
+
+	// number of elements or pairs, on begin events
+	std::uint32_t size() const noexcept
+	{
+		return this->count;
+	}
 
-		simba_value& operator=(const std::nullptr_t& nullValue)
-		{
-			this->destroyPtr();
-			return *this;
-		}
+	// number of characters of the whole string, on string events
+	std::uint32_t length() const noexcept
+	{
+		return this->count;
+	}
 
-		simba_value& operator=(const std::int8_t& int8)
-		{
-			this->simpleAlloc();
+	// arrays and objects the reader is inside of
+	std::size_t depth() const noexcept
+	{
+		return this->frames.size();
+	}
 
-			this->simbaType = simba_type_int8;
-			this->simbaTypeFlag = simba_type_flag_signed;
-			this->simpleValue->int8 = int8;
-			return *this;
-		}
+	// valid until the next call to next() or skip()
+	std::string_view key() const noexcept
+	{
+		return this->currentKey;
+	}
 
-		simba_value& operator=(const std::uint8_t& uint8)
-		{
-			this->simpleAlloc();
+	// the characters of the current string chunk in native byte order, a whole number of characters.
+	// Valid until the next call to next() or skip().
+	std::string_view chunk() const noexcept
+	{
+		return this->currentChunk;
+	}
 
-			this->simbaType = simba_type_int8;
-			this->simbaTypeFlag = simba_type_flag_unsigned;
-			this->simpleValue->uint8 = uint8;
-			return *this;
-		}
+	bool isLastChunk() const noexcept
+	{
+		return this->stringRemaining == 0u;
+	}
 
-		simba_value& operator=(const std::int16_t& int16)
-		{
-			this->simpleAlloc();
+	// T has to be the exact type of the current value, like simba_value::get
+	template<typename T>
+	T get() const
+	{
+		static_assert(simba::details::typed_element<T>::value, "No possible conversion for T");
 
-			this->simbaType = simba_type_int16;
-			this->simbaTypeFlag = simba_type_flag_signed;
-			this->simpleValue->int16 = int16;
-			return *this;
+		if (this->current != simba_event_value || this->type != simba::details::typed_element<T>::type || this->flag != simba::details::typed_element<T>::flag) {
+			throw std::exception("Attempted to retrieve a value of a different type (use cast instead).");
 		}
 
-		simba_value& operator=(const std::uint16_t& uint16)
-		{
-			this->simpleAlloc();
+		return simba::details::from_bits<T>(this->bits);
+	}
 
-			this->simbaType = simba_type_int16;
-			this->simbaTypeFlag = simba_type_flag_unsigned;
-			this->simpleValue->uint16 = uint16;
-			return *this;
-		}
+	template<typename T>
+	T cast() const
+	{
+		static_assert(std::is_arithmetic_v<T>, "Cannot cast to a non-arithmetic value");
 
-		simba_value& operator=(const std::int32_t& int32)
-		{
-			this->simpleAlloc();
+		T result{};
 
-			this->simbaType = simba_type_int32;
-			this->simbaTypeFlag = simba_type_flag_signed;
-			this->simpleValue->int32 = int32;
-			return *this;
+		if (this->current != simba_event_value || !simba::details::visitElementType(this->type, this->flag, [this, &result](auto value) {
+			result = static_cast<T>(simba::details::from_bits<decltype(value)>(this->bits));
+		})) {
+			throw std::exception("Unknown conversion to T");
 		}
 
-		simba_value& operator=(const std::uint32_t& uint32)
-		{
-			this->simpleAlloc();
+		return result;
+	}
 
-			this->simbaType = simba_type_int32;
-			this->simbaTypeFlag = simba_type_flag_unsigned;
-			this->simpleValue->uint32 = uint32;
-			return *this;
-		}
+private:
+	// an array, object or typed array being read
+	struct frame
+	{
+		std::uint8_t type = simba_type_array;
+		std::uint32_t remaining = 0u;
+		bool afterKey = false;
+
+		// typed arrays
+		std::uint8_t elementType = 0u;
+		std::uint8_t flag = 0u;
+		bool packed = false;
+		bool first = true;
+		std::uint8_t width = 0u;
+		std::uint64_t previous = 0u;
+		std::uint64_t reference = 0u;
+		std::uint64_t bitBuffer = 0u;
+		std::uint8_t bitCount = 0u;
+		std::size_t packedBytes = 0u; // not read yet
+	};
 
-		simba_value& operator=(const std::int64_t& int64)
-		{
-			this->simpleAlloc();
+	void readHeader()
+	{
+		char header[simba::SIMBA_HEADER_LEN];
+		this->input->read(header, simba::SIMBA_HEADER_LEN);
 
-			this->simbaType = simba_type_int64;
-			this->simbaTypeFlag = simba_type_flag_signed;
-			this->simpleValue->int64 = int64;
-			return *this;
+		if (memcmp(header, simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN)) {
+			throw std::exception("Not a valid simba header!");
 		}
 
-		simba_value& operator=(const std::uint64_t& uint64)
-		{
-			this->simpleAlloc();
+		auto endianess = this->readByte(*this->input);
 
-			this->simbaType = simba_type_int64;
-			this->simbaTypeFlag = simba_type_flag_unsigned;
-			this->simpleValue->uint64 = uint64;
-			return *this;
-		}
+		if (endianess & simba::details::SIMBA_HEADER_EXTENDED) {
+			const auto version = this->readByte(*this->input);
+			const auto flags = this->readByte(*this->input);
 
-		simba_value& operator=(const float& floatVal)
-		{
-			this->simpleAlloc();
+			if (version <= simba::SIMBA_FORMAT_V1 || version > simba::SIMBA_FORMAT_VERSION) {
+				throw std::exception("Unsupported simba format version");
+			}
 
-			this->simbaType = simba_type_float;
-			this->simpleValue->floatVal = floatVal;
-			return *this;
+			if (flags & ~simba::details::SIMBA_SUPPORTED_FLAGS) {
+				throw std::exception("Simba file uses unsupported features");
+			}
+
+			this->version = version;
+			this->compressed = (flags & simba::details::SIMBA_FLAG_COMPRESSED) != 0u;
+			this->deduplicated = (flags & simba::details::SIMBA_FLAG_STRING_TABLE) != 0u;
+			endianess &= ~simba::details::SIMBA_HEADER_EXTENDED;
+		}
+		else {
+			this->version = simba::SIMBA_FORMAT_V1;
 		}
 
-		simba_value& operator=(const double& doubleVal)
-		{
-			this->simpleAlloc();
+		this->needSwapEndianess = endianess != simba::details::getEndianess();
+	}
 
-			this->simbaType = simba_type_double;
-			this->simpleValue->doubleVal = doubleVal;
-			return *this;
-		}
+	template<typename Source>
+	void readStringTable(Source& source)
+	{
+		const auto count = this->getSize(source);
 
-		simba_value& operator=(const simba_object_type& object)
-		{
-			this->destroyPtr();
+		for (auto i = 0u; i < count; ++i) {
+			std::string str;
+			str.resize(this->getSize(source));
+			source.read(str.data(), static_cast<std::streamsize>(str.length()));
 
-			this->simbaType = simba_type_object;
-			this->objectValue = new simba_object_type(object);
-			return *this;
+			this->strings.push_back(std::move(str));
 		}
+	}
 
-		simba_value& operator=(const simba_array_type& array)
-		{
-			this->destroyPtr();
+	template<typename Source>
+	simba_event_t advance(Source& source)
+	{
+		this->currentKey = {};
 
-			this->simbaType = simba_type_array;
-			this->arrayValue = new simba_array_type(array);
-			return *this;
+		if (this->stringRemaining != 0u) {
+			return this->readChunk(source);
 		}
 
-		simba_value& operator=(const std::string& string)
-		{
-			if (this->simbaType == simba_type_string8) {
-				*this->string = string;
-			}
-			else {
-				this->destroyPtr();
-				this->string = new std::string(string);
-				this->simbaType = simba_type_string8;
+		if (this->frames.empty()) {
+			if (!this->rootPending) {
+				return this->setEvent(simba_event_end_of_input);
 			}
 
-			return *this;
+			this->rootPending = false;
+			return this->readValue(source);
 		}
 
-		simba_value& operator=(const std::u16string& u16string)
-		{
-			if (this->simbaType == simba_type_string16) {
-				*this->u16string = u16string;
-			}
-			else {
-				this->destroyPtr();
-				this->u16string = new std::u16string(u16string);
-				this->simbaType = simba_type_string16;
-			}
+		auto& top = this->frames.back();
 
-			return *this;
+		if (top.remaining == 0u && !top.afterKey) {
+			return this->endFrame();
 		}
 
-		simba_value& operator=(const std::u32string& u32string)
-		{
-			if (this->simbaType == simba_type_string32) {
-				*this->u32string = u32string;
-			}
-			else {
-				this->destroyPtr();
-				this->u32string = new std::u32string(u32string);
-				this->simbaType = simba_type_string32;
+		if (top.type == simba_type_object) {
+			if (!top.afterKey) {
+				--top.remaining;
+				top.afterKey = true;
+				this->currentKey = this->readKey(source);
+				return this->setEvent(simba_event_key);
 			}
 
-			return *this;
+			top.afterKey = false;
+			return this->readValue(source); // may add a frame, top is not used after this
 		}
 
-		simba_value& operator=(const std::wstring& wstring)
-		{
-			if (this->simbaType == simba_type_string_w) {
-				*this->wstring = wstring;
-			}
-			else {
-				this->destroyPtr();
-				this->wstring = new std::wstring(wstring);
-				this->simbaType = simba_type_string_w;
-			}
+		--top.remaining;
 
-			return *this;
+		if (top.type == simba_type_typed_array) {
+			return this->readTypedElement(source, top);
 		}
 
-		simba_value& operator[](const std::uint32_t& index)
-		{
-			if (this->simbaType != simba_type_array) {
-				throw std::exception("Cannot retrieve with integer index from non array type");
-			}
+		return this->readValue(source);
+	}
 
-			return this->arrayValue->at(index);
-		}
+	simba_event_t setEvent(simba_event_t event)
+	{
+		this->current = event;
+		return event;
+	}
 
-		const simba_value& operator[](const std::uint32_t& index) const
-		{
-			if (this->simbaType != simba_type_array) {
-				throw std::exception("Cannot retrieve with integer index from non array type");
-			}
+	simba_event_t endFrame()
+	{
+		this->type = this->frames.back().type == simba_type_object ? simba_type_object : simba_type_array;
+		this->frames.pop_back();
+		return this->setEvent(this->type == simba_type_object ? simba_event_end_object : simba_event_end_array);
+	}
 
-			return this->arrayValue->at(index);
-		}
+	simba_event_t setValue(std::uint8_t type, std::uint8_t flag, std::uint64_t bits)
+	{
+		this->type = type;
+		this->flag = flag;
+		this->bits = bits;
+		return this->setEvent(simba_event_value);
+	}
 
-		simba_value& operator[](const std::string& index)
-		{
-			if (this->simbaType != simba_type_object) {
-				throw std::exception("Cannot retrieve string index from non object type");
-			}
+	simba_event_t beginContainer(std::uint8_t type, std::uint32_t count)
+	{
+		frame container;
+		container.type = type;
+		container.remaining = count;
+		this->frames.push_back(container);
+
+		this->type = type;
+		this->flag = 0u;
+		this->elementType = 0u;
+		this->count = count;
+		return this->setEvent(type == simba_type_object ? simba_event_begin_object : simba_event_begin_array);
+	}
 
-			auto it = this->objectValue->find(index);
+	// decodes the tag of the next value, scalars are read completely, strings up to the first chunk
+	template<typename Source>
+	simba_event_t readValue(Source& source)
+	{
+		std::uint8_t tag = this->readByte(source);
 
-			if (it != this->objectValue->end()) {
-				return it->second;
+		if (this->version != simba::SIMBA_FORMAT_V1 && tag >= simba::details::SIMBA_TAG_TINYINT) {
+			if (tag >= simba::details::SIMBA_TAG_FIXINT) {
+				return this->setValue(simba_type_int32, simba_type_flag_signed, tag & 0x7Fu);
+			}
+			else if (tag >= simba::details::SIMBA_TAG_FIXOBJECT) {
+				return this->beginContainer(simba_type_object, tag & 0x0Fu);
+			}
+			else if (tag >= simba::details::SIMBA_TAG_FIXARRAY) {
+				return this->beginContainer(simba_type_array, tag & 0x0Fu);
+			}
+			else if (tag >= simba::details::SIMBA_TAG_FIXSTR) {
+				return this->beginString<char>(source, simba_type_string8, tag & 0x1Fu);
 			}
 
-			(*this->objectValue)[index] = simba::val(nullptr);
-
-			return (*this->objectValue)[index];
+			const auto type = static_cast<std::uint8_t>(simba_type_int8 + ((tag >> 3) & 0x03u));
+			return this->setValue(type, (tag & 0x04u) ? simba_type_flag_unsigned : simba_type_flag_signed, tag & 0x03u);
 		}
 
-		const simba_value& operator[](const std::string& index) const
-		{
-			if (this->simbaType != simba_type_object) {
-				throw std::exception("Cannot retrieve string index from non object type");
-			}
-
-			auto it = this->objectValue->find(index);
+		if (tag == simba::details::SIMBA_TAG_STRINGREF && this->deduplicated) {
+			const auto index = this->readVarint(source);
 
-			if (it != this->objectValue->end()) {
-				return it->second;
+			if (index >= this->strings.size()) {
+				throw std::exception("Invalid string table index, corrupted file?");
 			}
 
-			throw std::exception("Cannot create item with operator[] when in const scope");
+			this->currentChunk = this->strings[static_cast<std::size_t>(index)];
+			this->type = simba_type_string8;
+			this->count = static_cast<std::uint32_t>(this->currentChunk.size());
+			return this->setEvent(simba_event_string);
 		}
 
-		bool operator==(const simba_value& other) const
-		{
-			// Basic type check
-			if (other.simbaType != this->simbaType) {
-				return false;
-			}
+		std::uint8_t flag = 0u;
 
-			// signed/unsigned check
-			if (simba::details::hasTypeFlag(this->simbaType) && other.simbaTypeFlag != this->simbaTypeFlag) {
-				return false;
-			}
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			flag = tag >> 4;
+			tag &= 0x0Fu;
+		}
+		else if (simba::details::hasTypeFlag(tag)) {
+			flag = this->readByte(source);
+		}
 
-			switch (this->simbaType) {
-			case simba_type_null:
-				return true; // both are null
-				break;
+		switch (tag) {
+		case simba_type_null:
+			return this->setValue(simba_type_null, 0u, 0u);
+		case simba_type_int8:
+		case simba_type_int16:
+		case simba_type_int32:
+		case simba_type_int64:
+			simba::details::visitElementType(tag, flag, [this, &source, tag, flag](auto value) {
+				this->setValue(tag, flag, simba::details::to_bits(this->readInteger<decltype(value)>(source)));
+			});
+			return this->current;
+		case simba_type_float:
+			return this->setValue(tag, simba_type_flag_signed, simba::details::to_bits(this->readFixed<float>(source)));
+		case simba_type_double:
+			return this->setValue(tag, simba_type_flag_signed, simba::details::to_bits(this->readFixed<double>(source)));
+		case simba_type_object:
+		case simba_type_array:
+			return this->beginContainer(tag, this->getSize(source));
+		case simba_type_string8:
+			return this->readString<char>(source, tag);
+		case simba_type_string16:
+			return this->readString<char16_t>(source, tag);
+		case simba_type_string32:
+			return this->readString<char32_t>(source, tag);
+		case simba_type_string_w:
+			return this->readString<wchar_t>(source, tag);
+		case simba_type_typed_array:
+			return this->beginTypedArray(source);
+		}
 
-			case simba_type_int8:
-				if (this->isSigned()) {
-					return this->simpleValue->int8 == other.simpleValue->int8;
-				}
-				return this->simpleValue->uint8 == other.simpleValue->uint8;
-				break;
-			case simba_type_int16:
-				if (this->isSigned()) {
-					return this->simpleValue->int16 == other.simpleValue->int16;
-				}
-				return this->simpleValue->uint16 == other.simpleValue->uint16;
-				break;
-			case simba_type_int32:
-				if (this->isSigned()) {
-					return this->simpleValue->int32 == other.simpleValue->int32;
-				}
-				return this->simpleValue->uint32 == other.simpleValue->uint32;
-				break;
-			case simba_type_int64:
-				if (this->isSigned()) {
-					return this->simpleValue->int64 == other.simpleValue->int64;
-				}
-				return this->simpleValue->uint64 == other.simpleValue->uint64;
-				break;
-			case simba_type_float:
-				return this->simpleValue->floatVal == other.simpleValue->floatVal;
-				break;
-			case simba_type_double:
-				return this->simpleValue->doubleVal = other.simpleValue->doubleVal;
-				break;
-			case simba_type_array:
-				if (this->arrayValue->size() != other.arrayValue->size()) {
-					return false;
-				}
+		throw std::exception("Unknown simba_value type read, corrupted file?");
+	}
 
-				{ // compare all elements of the array
-					auto it1 = this->arrayValue->cbegin(),
-						end1 = this->arrayValue->cend(),
-						it2 = other.arrayValue->cbegin(),
-						end2 = other.arrayValue->cend();
+	template<typename CharType, typename Source>
+	simba_event_t readString(Source& source, std::uint8_t type)
+	{
+		std::uint32_t strCharSize = sizeof(CharType);
 
-					for (; it1 != end1 && it2 != end2; ++it1, ++it2) {
-						if (*it1 != *it2) {
-							return false;
-						}
-					}
+		if (this->version == simba::SIMBA_FORMAT_V1 || std::is_same_v<CharType, wchar_t>) {
+			strCharSize = this->getSize(source);
+		}
 
-					return true;
-				}
-				break;
-			case simba_type_object:
-				if (this->objectValue->size() != other.objectValue->size()) {
-					return false;
-				}
+		if (strCharSize != sizeof(CharType)) {
+			throw std::exception("Stored character size doesn't match this platform");
+		}
 
-				{ // recursively check all key/value pairs
-					for (auto it = this->objectValue->cbegin(), end = this->objectValue->cend();
-						it != end; ++it) {
-						auto found = other.objectValue->find(it->first);
+		return this->beginString<CharType>(source, type, this->getSize(source));
+	}
 
-						if (found == other.objectValue->end()) {
-							return false;
-						}
+	template<typename CharType, typename Source>
+	simba_event_t beginString(Source& source, std::uint8_t type, std::uint32_t strLen)
+	{
+		this->type = type;
+		this->count = strLen;
+		this->charSize = sizeof(CharType);
+		this->stringRemaining = static_cast<std::size_t>(strLen) * sizeof(CharType);
+		return this->readChunk(source);
+	}
+
+	// chunks hold whole characters, SIMBA_READER_CHUNK is a multiple of every character size
+	template<typename Source>
+	simba_event_t readChunk(Source& source)
+	{
+		const auto len = std::min(this->stringRemaining, simba::details::SIMBA_READER_CHUNK);
+		char* buffer = this->chunkBuffer.get();
 
-						if (it->second != found->second) {
-							return false;
-						}
-					}
+		source.read(buffer, static_cast<std::streamsize>(len));
+		this->stringRemaining -= len;
 
-					return true;
-				}
-				break;
-			case simba_type_string8:
-				return *this->string == *other.string;
-				break;
-			case simba_type_string16:
-				return *this->u16string == *other.u16string;
-				break;
-			case simba_type_string32:
-				return *this->u32string == *other.u32string;
+		if (this->needSwapEndianess) {
+			switch (this->charSize) {
+			case 2:
+				simba::details::swap_buffer(reinterpret_cast<std::uint16_t*>(buffer), len / 2u);
 				break;
-			case simba_type_string_w:
-				return *this->wstring == *other.wstring;
+			case 4:
+				simba::details::swap_buffer(reinterpret_cast<std::uint32_t*>(buffer), len / 4u);
 				break;
 			}
+		}
 
+		this->currentChunk = { buffer, len };
+		return this->setEvent(simba_event_string);
+	}
 
-			return false; // unknown types??
-		}
+	// see simba_deserializer::readTypedArray and readPackedIntegers
+	template<typename Source>
+	simba_event_t beginTypedArray(Source& source)
+	{
+		const auto elementTag = this->readByte(source);
 
-		bool operator!=(const simba_value& other) const
-		{
-			return !(*this == other);
-		}
-#pragma endregion operators
+		frame container;
+		container.type = simba_type_typed_array;
+		container.remaining = this->getSize(source);
+		container.packed = (elementTag & simba::details::SIMBA_ELEMENT_PACKED) != 0u;
+		container.elementType = elementTag & 0x0Fu;
+		container.flag = (elementTag >> 4) & 0x01u;
 
-	private: // general private functions
+		const bool asArray = (elementTag & simba::details::SIMBA_ELEMENT_AS_ARRAY) != 0u;
 
-		// allocate a simple value (but an allocation is only actually done if the current type is not a simple value)
-		void simpleAlloc()
-		{
-			if (this->simpleValue == nullptr) {
-				// not a simple value...
-				this->destroyPtr();
-				this->simpleValue = new simba_value::simba_simple_type;
-			}
+		if ((elementTag & 0x20u) || (asArray && !container.packed)
+			|| !simba::details::visitElementType(container.elementType, container.flag, [](auto) {})) {
+			throw std::exception("Unknown typed array element type, corrupted file?");
 		}
 
-		void destroyPtr()
-		{
-			if (this->simpleValue != nullptr) {
-				delete this->simpleValue;
-				this->simpleValue = nullptr;
-			}
-
-			if (this->objectValue != nullptr) {
-				delete this->objectValue;
-				this->objectValue = nullptr;
+		if (container.packed) {
+			if (container.elementType == simba_type_float || container.elementType == simba_type_double) {
+				throw std::exception("Packed typed array of floating point values, corrupted file?");
 			}
 
-			if (this->arrayValue != nullptr) {
-				delete this->arrayValue;
-				this->arrayValue = nullptr;
+			if (container.remaining != 0u) {
+				container.previous = static_cast<std::uint64_t>(simba::details::unzigzag(this->readVarint(source)));
 			}
 
-			if (this->string != nullptr) {
-				delete this->string;
-				this->string = nullptr;
-			}
+			if (container.remaining > 1u) {
+				container.reference = static_cast<std::uint64_t>(simba::details::unzigzag(this->readVarint(source)));
+				container.width = this->readByte(source);
 
-			if (this->wstring != nullptr) {
-				delete this->wstring;
-				this->wstring = nullptr;
-			}
+				if (container.width > simba::details::SIMBA_MAX_PACKED_WIDTH) {
+					throw std::exception("Invalid packed integer width, corrupted file?");
+				}
 
-			if (this->u16string != nullptr) {
-				delete this->u16string;
-				this->u16string = nullptr;
+				container.packedBytes = (static_cast<std::size_t>(container.remaining - 1u) * container.width + 7u) / 8u;
 			}
+		}
 
-			if (this->u32string != nullptr) {
-				delete this->u32string;
-				this->u32string = nullptr;
-			}
+		this->frames.push_back(container);
 
-			this->simbaType = simba_type_null;
-		}
+		this->type = asArray ? simba_type_array : simba_type_typed_array;
+		this->flag = container.flag;
+		this->elementType = container.elementType;
+		this->count = container.remaining;
+		return this->setEvent(simba_event_begin_array);
+	}
 
-	private:
-		std::uint8_t simbaType = simba_type_null,
-			simbaTypeFlag = simba_type_flag_signed;
-		simba_simple_type* simpleValue = nullptr;
-		simba_object_type* objectValue = nullptr;
-		simba_array_type* arrayValue = nullptr;
-		std::string* string = nullptr;
-		std::wstring* wstring = nullptr;
-		std::u16string* u16string = nullptr;
-		std::u32string* u32string = nullptr;
-	};
+	// packed deltas are little endian bit fields, read a byte at a time as they're needed
+	template<typename Source>
+	simba_event_t readTypedElement(Source& source, frame& container)
+	{
+		if (container.packed) {
+			if (!container.first) {
+				while (container.bitCount < container.width) {
+					container.bitBuffer |= static_cast<std::uint64_t>(this->readByte(source)) << container.bitCount;
+					container.bitCount += 8u;
+					--container.packedBytes;
+				}
 
-	constexpr auto SIMBA_SIZE = sizeof(simba_value);
-}
+				const auto mask = container.width == 0u ? 0u : ~std::uint64_t{ 0u } >> (64u - container.width);
+				container.previous += container.reference + (container.bitBuffer & mask);
+				container.bitBuffer = container.width == 0u ? container.bitBuffer : container.bitBuffer >> container.width;
+				container.bitCount -= container.width;
+			}
 
-std::uint8_t simba::details::swap_uint8(std::uint8_t val)
-{
-	return static_cast<std::uint8_t>(swap_uint16(val));
-}
+			container.first = false;
 
-//! Byte swap short
-std::int8_t simba::details::swap_int8(std::int8_t val)
-{
-	return static_cast<std::int8_t>(swap_int16(val));
-}
+			std::uint64_t bits = 0u;
+			simba::details::visitElementType(container.elementType, container.flag, [&container, &bits](auto value) {
+				bits = simba::details::to_bits(static_cast<decltype(value)>(container.previous));
+			});
 
-std::uint16_t simba::details::swap_uint16(std::uint16_t val)
-{
-	return (val << 8) | (val >> 8);
-}
+			return this->setValue(container.elementType, container.flag, bits);
+		}
 
-//! Byte swap short
-std::int16_t simba::details::swap_int16(std::int16_t val)
-{
-	return (val << 8) | ((val >> 8) & 0xFF);
-}
+		std::uint64_t bits = 0u;
+		simba::details::visitElementType(container.elementType, container.flag, [this, &source, &bits](auto value) {
+			source.read(reinterpret_cast<char*>(&value), sizeof(value));
 
-//! Byte swap unsigned int
-std::uint32_t simba::details::swap_uint32(std::uint32_t val)
-{
-	val = ((val << 8) & 0xFF00FF00) | ((val >> 8) & 0xFF00FF);
-	return (val << 16) | (val >> 16);
-}
+			if (this->needSwapEndianess) {
+				simba::details::swap_buffer(&value, 1u);
+			}
 
-//! Byte swap int
-std::int32_t simba::details::swap_int32(std::int32_t val)
-{
-	val = ((val << 8) & 0xFF00FF00) | ((val >> 8) & 0xFF00FF);
-	return (val << 16) | ((val >> 16) & 0xFFFF);
-}
+			bits = simba::details::to_bits(value);
+		});
 
-std::int64_t simba::details::swap_int64(std::int64_t val)
-{
-	val = ((val << 8) & 0xFF00FF00FF00FF00ULL) | ((val >> 8) & 0x00FF00FF00FF00FFULL);
-	val = ((val << 16) & 0xFFFF0000FFFF0000ULL) | ((val >> 16) & 0x0000FFFF0000FFFFULL);
-	return (val << 32) | ((val >> 32) & 0xFFFFFFFFULL);
-}
+		return this->setValue(container.elementType, container.flag, bits);
+	}
 
-std::uint64_t simba::details::swap_uint64(std::uint64_t val)
-{
-	val = ((val << 8) & 0xFF00FF00FF00FF00ULL) | ((val >> 8) & 0x00FF00FF00FF00FFULL);
-	val = ((val << 16) & 0xFFFF0000FFFF0000ULL) | ((val >> 16) & 0x0000FFFF0000FFFFULL);
-	return (val << 32) | (val >> 32);
-}
+	// keys are read into a reused buffer, or point into the string table
+	template<typename Source>
+	std::string_view readKey(Source& source)
+	{
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			std::uint8_t tag = this->readByte(source);
 
-std::uint8_t simba::details::getEndianess()
-{
-	short int word = 0x0001;
-	return reinterpret_cast<std::int8_t*>(&word)[0] ? little_endian : big_endian;
-}
+			if (tag != simba_type_string8 || this->getSize(source) != sizeof(char)) {
+				throw std::exception("Object key isn't a string, corrupted file?");
+			}
+		}
+		else if (this->deduplicated) {
+			const auto entry = this->readVarint(source);
 
-bool simba::details::hasTypeFlag(const std::uint8_t & type)
-{
-	return type > simba_type_null&& type <= simba_type_int64;
-}
+			if (entry & 1u) {
+				if ((entry >> 1) >= this->strings.size()) {
+					throw std::exception("Invalid string table index, corrupted file?");
+				}
 
-template<typename T>
-std::pair<std::string, simba::simba_value> simba::pair(std::string str, T value)
-{
-	return { std::move(str), simba::simba_value(std::move(value)) };
-}
+				return this->strings[static_cast<std::size_t>(entry >> 1)];
+			}
 
-template<typename T>
-simba::simba_value simba::val(T && value)
-{
-	return simba_value(std::forward<T>(value));
-}
+			if ((entry >> 1) > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::exception("Stored size is too large, corrupted file?");
+			}
 
-simba::simba_value simba::val()
-{
-	return { nullptr };
-}
+			this->keyBuffer.resize(static_cast<std::size_t>(entry >> 1));
+			source.read(this->keyBuffer.data(), static_cast<std::streamsize>(this->keyBuffer.size()));
+			return this->keyBuffer;
+		}
 
-template<typename ...Args>
-simba::simba_value simba::array(Args && ...args)
-{
-	simba::simba_value arr = simba_value::simba_array_type{};
-	simba::details::array_impl<Args...>::append(arr, std::forward<Args>(args)...);
-	return arr;
-}
+		this->keyBuffer.resize(this->getSize(source));
+		source.read(this->keyBuffer.data(), static_cast<std::streamsize>(this->keyBuffer.size()));
+		return this->keyBuffer;
+	}
 
-template<typename T, typename ...Args>
-struct simba::details::array_impl<T, Args...>
-{
-	static void append(simba_value& arr, T&& t, Args&& ...args)
+	template<typename Source>
+	void skipCurrent(Source& source)
 	{
-		arr.getArray().emplace_back(simba::val(std::forward<T>(t)));
-		array_impl<Args...>::append(arr, std::forward<Args>(args)...);
+		switch (this->current) {
+		case simba_event_begin_array:
+		case simba_event_begin_object:
+			this->skipFrame(source);
+			break;
+		case simba_event_key:
+			this->frames.back().afterKey = false;
+			this->skipValue(source);
+			break;
+		case simba_event_string:
+			this->discard(source, this->stringRemaining);
+			this->stringRemaining = 0u;
+			break;
+		default:
+			break; // nothing left to skip
+		}
 	}
-};
 
-template<typename T>
-struct simba::details::array_impl<T>
-{
-	static void append(simba_value& arr, T&& t)
+	// reads the rest of the innermost container without reporting it and leaves the reader on its end event
+	template<typename Source>
+	void skipFrame(Source& source)
 	{
-		arr.getArray().emplace_back(simba::val(std::forward<T>(t)));
-	}
-};
+		const auto top = this->frames.size() - 1u;
 
-template<>
-struct simba::details::array_impl<>
-{
-	static void append(simba_value& arr)
-	{}
-};
+		if (this->frames[top].type == simba_type_typed_array) {
+			const auto& container = this->frames[top];
 
+			if (container.packed) {
+				this->discard(source, container.packedBytes);
+			}
+			else {
+				simba::details::visitElementType(container.elementType, container.flag, [this, &source, &container](auto value) {
+					this->discard(source, static_cast<std::size_t>(container.remaining) * sizeof(value));
+				});
+			}
+		}
+		else {
+			// nested values push frames of their own, which may move this one
+			for (; this->frames[top].remaining != 0u; --this->frames[top].remaining) {
+				if (this->frames[top].type == simba_type_object) {
+					this->readKey(source);
+				}
 
-template<typename ...Args>
-simba::simba_value simba::object(Args && ...args)
-{
-	simba::simba_value obj = simba_value::simba_object_type{};
-	simba::details::object_impl<Args...>::append(obj, std::forward<Args>(args)...);
-	return obj;
-}
+				this->skipValue(source);
+			}
+		}
 
+		this->frames[top].remaining = 0u;
+		this->frames[top].afterKey = false;
+		this->endFrame();
+	}
 
-template<typename T1, typename T2, typename...Args>
-struct simba::details::object_impl<std::pair<T1, T2>, Args...>
-{
-	static void append(simba_value& obj, std::pair<T1, T2> pair, Args&& ...args)
+	template<typename Source>
+	void skipValue(Source& source)
 	{
-		obj.getObject()[pair.first] = simba::val(pair.second);
-		object_impl<Args...>::append(obj, std::forward<Args>(args)...);
+		const auto event = this->readValue(source);
+
+		if (event == simba_event_begin_array || event == simba_event_begin_object) {
+			this->skipFrame(source);
+		}
+		else if (event == simba_event_string) {
+			this->discard(source, this->stringRemaining);
+			this->stringRemaining = 0u;
+		}
 	}
-};
 
-template<typename T1, typename T2>
-struct simba::details::object_impl<std::pair<T1, T2>>
-{
-	static void append(simba_value& obj, std::pair<T1, T2> pair)
+	template<typename Source>
+	void discard(Source& source, std::size_t len)
 	{
-		obj.getObject()[pair.first] = simba::val(pair.second);
+		while (len != 0u) {
+			const auto part = std::min(len, simba::details::SIMBA_READER_CHUNK);
+			source.read(this->chunkBuffer.get(), static_cast<std::streamsize>(part));
+			len -= part;
+		}
 	}
-};
-
-template<>
-struct simba::details::object_impl<>
-{
-	static void append(simba_value& obj)
-	{}
-};
 
-class simba::details::simba_input_adapter
-{
-public:
-	// return the size of the input buffer
-	virtual std::streamsize size() const = 0;
+	template<typename Source>
+	std::uint8_t readByte(Source& source)
+	{
+		std::uint8_t byte{ 0u };
+		source.read(reinterpret_cast<char*>(&byte), 1);
+		return byte;
+	}
 
-	// return the cursor position
-	virtual std::streamsize cur() const = 0;
+	template<typename Source>
+	std::uint64_t readVarint(Source& source)
+	{
+		std::uint64_t result{ 0u };
 
-	// read length amount of bytes into buffer
-	virtual std::streamsize read(char* buffer, std::streamsize length) = 0;
-};
+		for (auto shift = 0u; shift < 64u; shift += 7u) {
+			const auto byte = this->readByte(source);
 
-class simba::details::simba_string_input_adapter : public simba::details::simba_input_adapter
-{
-public:
-	simba_string_input_adapter(std::string str)
-		: str(std::move(str))
-	{}
+			result |= static_cast<std::uint64_t>(byte & 0x7Fu) << shift;
 
-	std::streamsize size() const
-	{
-		return static_cast<std::streamsize>(this->str.length());
-	}
+			if (!(byte & 0x80u)) {
+				return result;
+			}
+		}
 
-	std::streamsize cur() const
-	{
-		return this->cursor;
+		throw std::exception("Invalid varint, corrupted file?");
 	}
 
-	std::streamsize read(char* buffer, std::streamsize length)
+	// v1: 4 byte unsigned integer, v2: LEB128 varint
+	template<typename Source>
+	std::uint32_t getSize(Source& source)
 	{
-		const auto beg = this->cursor;
-		auto end = this->cursor + length;
+		if (this->version != simba::SIMBA_FORMAT_V1) {
+			const auto sz = this->readVarint(source);
 
-		if (end >= this->str.length()) {
-			end = this->str.length() - 1;
-		}
+			if (sz > std::numeric_limits<std::uint32_t>::max()) {
+				throw std::exception("Stored size is too large, corrupted file?");
+			}
 
-		const char* data = this->str.data();
-		while (length--) {
-			buffer[this->cursor - beg] = data[this->cursor];
-			++this->cursor;
+			return static_cast<std::uint32_t>(sz);
 		}
 
-		return end - beg;
-	}
-
-private:
-	std::string str;
-	std::streamsize cursor = 0u;
-};
+		std::uint32_t sz{ 0u };
+		source.read(reinterpret_cast<char*>(&sz), sizeof(sz));
 
-class simba::details::simba_stream_input_adapter : public simba::details::simba_input_adapter
-{
-public:
-	simba_stream_input_adapter(std::basic_istream<char>& file)
-		: inputFile(&file)
-	{
-		this->inputFile->ignore(std::numeric_limits<std::streamsize>::max());
-		this->inputFile->seekg(0, std::ios::end);
-		this->fileLength = this->inputFile->gcount();
-		this->inputFile->clear();
-		this->inputFile->seekg(0, std::ios::beg);
+		return this->needSwapEndianess ? simba::details::swap_uint32(sz) : sz;
 	}
 
-	std::streamsize size() const
+	// v1 prefixes every scalar with its size, v2 knows the size from the type
+	template<typename T, typename Source>
+	T readFixed(Source& source)
 	{
-		return this->fileLength;
-	}
+		T t{ 0 };
+		std::uint32_t size = sizeof(T);
 
-	std::streamsize cur() const
-	{
-		return this->inputFile->tellg();
-	}
+		if (this->version == simba::SIMBA_FORMAT_V1) {
+			size = this->getSize(source);
 
-	std::streamsize read(char* buffer, std::streamsize length)
-	{
-		this->inputFile->read(buffer, length);
-		return this->inputFile->gcount();
-	}
+			if (size > sizeof(T)) {
+				throw std::exception("Cannot read value into T because stored size is larger than size of T");
+			}
+		}
 
-private:
-	std::basic_istream<char>* inputFile = nullptr;
-	std::streamsize fileLength = 0u;
-};
+		source.read(reinterpret_cast<char*>(&t), size);
 
-class simba::details::simba_output_adapter
-{
-public:
-	virtual std::streamsize write(const char* buffer, std::streamsize len) = 0;
-};
+		if (this->needSwapEndianess) {
+			simba::details::swap_buffer(&t, 1u);
+		}
 
-class simba::details::simba_stream_output_adapter : public simba::details::simba_output_adapter
-{
-public:
-	simba_stream_output_adapter(std::basic_ostream<char>& file)
-		: file(&file)
-	{}
+		return t;
+	}
 
-	std::streamsize write(const char* buffer, std::streamsize len)
+	template<typename T, typename Source>
+	T readInteger(Source& source)
 	{
-		this->file->write(buffer, len);
-		return len;
+		if (this->version == simba::SIMBA_FORMAT_V1 || sizeof(T) == 1) {
+			return this->readFixed<T>(source);
+		}
+		else {
+			return simba::details::narrow_varint<T>(this->readVarint(source));
+		}
 	}
 
 private:
-	std::basic_ostream<char>* file;
+	Adapter* input;
+	std::optional<simba::details::simba_decompress_input_adapter<Adapter>> blocks;
+	std::unique_ptr<char[]> chunkBuffer;
+	std::vector<frame> frames;
+	std::vector<std::string> strings;
+	std::string keyBuffer;
+	std::string_view currentKey;
+	std::string_view currentChunk;
+	std::size_t stringRemaining = 0u;
+	std::uint8_t charSize = 1u;
+	simba_event_t current = simba_event_end_of_input;
+	std::uint8_t type = simba_type_null;
+	std::uint8_t flag = 0u;
+	std::uint8_t elementType = 0u;
+	std::uint32_t count = 0u;
+	std::uint64_t bits = 0u;
+	std::uint8_t version = simba::SIMBA_FORMAT_VERSION;
+	bool compressed = false;
+	bool deduplicated = false;
+	bool needSwapEndianess = false;
+	bool rootPending = true;
 };
 
-class simba::details::simba_serializer
+// Writes a value straight to an output adapter as it's produced, without building a simba_value tree first,
+// so exporters can stream records of any number and size with memory bounded by the nesting depth.
+// Arrays and objects either declare their count up front or leave it open: the count is then written as a
+// padded varint of SIMBA_WRITER_COUNT_BYTES and patched by end*() through the adapter's overwrite(), which
+// buffers, pointers, seekable streams and seekable file descriptors support.
+// The output is plain format v2, the writer has to be the first thing written to the adapter.
+template<typename Adapter>
+class simba::simba_writer
 {
 public:
-	using adapter_t = simba::details::simba_output_adapter;
+	// writes the header right away
+	explicit simba_writer(Adapter& output)
+		: output{ &output }, serializer(nullptr)
+	{
+		this->serializer.writeHeader(this->output);
+	}
 
-public:
-	simba_serializer(const simba_value* value)
-		: value(value)
-	{}
+	simba_writer(const simba_writer&) = delete;
+	simba_writer& operator=(const simba_writer&) = delete;
 
-	void to(adapter_t& stream)
+	simba_writer& beginArray(std::uint32_t count)
 	{
-		this->writeHeader(stream);
-		this->writeElement(stream, this->value);
+		return this->begin(simba_type_array, count, false);
 	}
 
-	void to(const std::string& filename)
+	// the count is patched in by endArray(), the adapter has to support overwrite()
+	simba_writer& beginArray()
 	{
-		std::ofstream fileStream{ filename, std::ios::binary };
-		simba::details::simba_stream_output_adapter adapter{ fileStream };
-		this->to(adapter);
+		return this->begin(simba_type_array, 0u, true);
 	}
 
-private:
-	void writeHeader(adapter_t& stream)
+	simba_writer& beginObject(std::uint32_t count)
 	{
-		stream.write(simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN);
-
-		auto endianess = simba::details::getEndianess();
-		stream.write(reinterpret_cast<const char*>(&endianess), sizeof(endianess));
+		return this->begin(simba_type_object, count, false);
 	}
 
-	void writeElement(adapter_t& stream, const simba_value* value)
+	// the count is patched in by endObject(), the adapter has to support overwrite()
+	simba_writer& beginObject()
 	{
-		this->writeElementType(stream, value->getType(), value->getTypeFlag());
+		return this->begin(simba_type_object, 0u, true);
+	}
 
-		auto size = [&stream](const std::uint32_t & size) {
-			static_assert(sizeof(std::uint32_t) == 4, "Invalid integer size type");
-			stream.write(reinterpret_cast<const char*>(&size), sizeof(std::uint32_t)); // always write the size as a 4 byte unsigned integer.
-		};
+	simba_writer& endArray()
+	{
+		return this->end(simba_type_array);
+	}
 
-		switch (value->getType()) {
-		case simba_type_null:
-			// dont write anything
-			break;
-		case simba_type_int8:
-			if (value->isSigned()) {
-				size(sizeof(std::int8_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::int8_t>()), sizeof(std::int8_t));
-			}
-			else {
-				size(sizeof(std::uint8_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::uint8_t>()), sizeof(std::uint8_t));
-			}
-			break;
-		case simba_type_int16:
-			if (value->isSigned()) {
-				size(sizeof(std::int16_t));
-				stream.write(reinterpret_cast<const char*>(&value->get<std::int16_t>()), sizeof(std::int16_t));
-			}
-			else {
-				size(sizeof(std::uint16_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::uint16_t>()), sizeof(std::uint16_t));
-			}
-			break;
-		case simba_type_int32:
-			if (value->isSigned()) {
-				size(sizeof(std::int32_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::int32_t>()), sizeof(std::int32_t));
-			}
-			else {
-				size(sizeof(std::uint32_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::uint32_t>()), sizeof(std::uint32_t));
-			}
-			break;
-		case simba_type_int64:
-			if (value->isSigned()) {
-				size(sizeof(std::int64_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::int64_t>()), sizeof(std::int64_t));
-			}
-			else {
-				size(sizeof(std::uint64_t));
-				stream.write(reinterpret_cast<const char*> (&value->get<std::uint64_t>()), sizeof(std::uint64_t));
-			}
-			break;
-		case simba_type_float:
-			size(sizeof(float));
-			stream.write(reinterpret_cast<const char*> (&value->get<float>()), sizeof(float));
-			break;
-		case simba_type_double:
-			size(sizeof(double));
-			stream.write(reinterpret_cast<const char*> (&value->get<double>()), sizeof(double));
-			break;
-		case simba_type_array:
-			size(value->size());
-			for (auto& el : value->getArray()) {
-				this->writeElement(stream, &el);
-			}
-			break;
-		case simba_type_object:
-			size(value->size());
-			for (auto& el : value->getObject()) {
-				auto strEl = simba::val(el.first);
-				this->writeElement(stream, &strEl);
-				this->writeElement(stream, &el.second);
-			}
-			break;
-		case simba_type_string8:
-			size(sizeof(char));
-			size(value->length());
-			stream.write(reinterpret_cast<const char*>(value->get<std::string>().c_str()), value->length());
-			break;
-		case simba_type_string16:
-			size(sizeof(std::u16string::value_type));
-			size(value->length());
-			stream.write(reinterpret_cast<const char*>(value->get<std::u16string>().c_str()), value->length() * sizeof(std::u16string::value_type));
-			break;
-		case simba_type_string32:
-			size(sizeof(std::u32string::value_type));
-			size(value->length());
-			stream.write(reinterpret_cast<const char*>(value->get<std::u32string>().c_str()), value->length() * sizeof(std::u32string::value_type));
-			break;
-		case simba_type_string_w:
-			size(sizeof(std::wstring::value_type));
-			size(value->length());
-			stream.write(reinterpret_cast<const char*>(value->get<std::wstring>().c_str()), value->length() * sizeof(std::wstring::value_type));
-			break;
-		}
+	simba_writer& endObject()
+	{
+		return this->end(simba_type_object);
 	}
 
-	void writeElementType(adapter_t& stream, const std::uint8_t& type, const std::uint8_t& typeFlag)
+	// key of the next value of the current object
+	simba_writer& key(std::string_view key)
 	{
-		// Write type
-		stream.write(reinterpret_cast<const char*>(&type), 1);
+		if (this->frames.empty() || this->frames.back().type != simba_type_object) {
+			throw std::exception("A key can only be written inside an object");
+		}
 
-		if (simba::details::hasTypeFlag(type)) {
-			stream.write(reinterpret_cast<const char*>(&typeFlag), 1);
+		if (this->frames.back().afterKey) {
+			throw std::exception("Expected a value after the key");
 		}
+
+		this->frames.back().afterKey = true;
+		this->serializer.writeSize(this->output, key.length());
+		this->output.write(key.data(), static_cast<std::streamsize>(key.length()));
+		return *this;
 	}
 
-private:
-	const simba_value* value = nullptr;
-};
+	simba_writer& value(std::string_view str)
+	{
+		this->element();
 
-class simba::details::simba_deserializer
-{
-public:
-	using adapter_t = simba::details::simba_input_adapter;
+		if (str.length() < 32u) {
+			const auto tag = static_cast<std::uint8_t>(simba::details::SIMBA_TAG_FIXSTR | str.length());
+			this->output.write(reinterpret_cast<const char*>(&tag), 1);
+		}
+		else {
+			this->serializer.writeElementType(this->output, simba_type_string8, simba_type_flag_signed);
+			this->serializer.writeSize(this->output, str.length());
+		}
 
-public:
-	simba_deserializer(simba_value* value)
-		: value(value)
-	{}
+		this->output.write(str.data(), static_cast<std::streamsize>(str.length()));
+		return *this;
+	}
 
-	void from(adapter_t& adapter)
+	simba_writer& value(const char* str)
 	{
-		this->readHeader(adapter);
-		this->readElement(adapter, this->value);
+		return this->value(std::string_view{ str });
 	}
 
-	void from(const std::string& filename)
+	simba_writer& value(const std::string& str)
 	{
-		std::ifstream file{ filename, std::ios::binary };
-		simba::details::simba_stream_input_adapter adapter{ file };
-		this->from(adapter);
+		return this->value(std::string_view{ str });
 	}
 
-	void fromString(const std::string& input)
+	simba_writer& value(std::nullptr_t)
 	{
-		simba::details::simba_string_input_adapter adapter{ input };
-		this->from(adapter);
+		return this->value(simba_value{});
 	}
 
-private:
-	void readHeader(adapter_t& adapter)
+	template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+	simba_writer& value(const T& scalar)
 	{
-		char header[5];
-
-		adapter.read(header, 5);
+		return this->value(simba_value(scalar));
+	}
 
-		if (memcmp(header, simba::SIMBA_HEADER, simba::SIMBA_HEADER_LEN)) {
-			throw std::exception("Not a valid simba header!");
-		}
+	// any value including whole arrays and objects, e.g. a record built as a tree
+	simba_writer& value(const simba_value& value)
+	{
+		this->element();
+		this->serializer.writeElement(this->output, &value);
+		return *this;
+	}
 
-		std::uint8_t endianess{ 0u };
+	template<typename T, typename = std::enable_if_t<simba::details::typed_element<T>::value>>
+	simba_writer& typedArray(const T* data, std::size_t count)
+	{
+		this->element();
 
-		adapter.read(reinterpret_cast<char*>(&endianess), 1);
+		const std::uint8_t tags[] = { simba_type_typed_array, static_cast<std::uint8_t>(simba::details::typed_element<T>::type | simba::details::typed_element<T>::flag << 4) };
+		this->output.write(reinterpret_cast<const char*>(tags), sizeof(tags));
+		this->serializer.writeSize(this->output, count);
 
-		if (endianess != simba::details::getEndianess()) {
-			this->needSwapEndianess = true;
+		if (count != 0u) {
+			this->output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
 		}
+
+		return *this;
 	}
 
-	std::pair<std::uint8_t, std::uint8_t> readElementType(adapter_t& adapter)
+	// checks that the root value is complete and flushes the adapter
+	void finish()
 	{
-		std::pair<std::uint8_t, std::uint8_t> result{ 0u, 0u };
-		adapter.read(reinterpret_cast<char*>(&result.first), 1);
-
-		if (this->needSwapEndianess) {
-			result.first = simba::details::swap_uint8(result.first);
+		if (!this->frames.empty() || !this->rootWritten) {
+			throw std::exception("The root value hasn't been completed");
 		}
 
-		if (simba::details::hasTypeFlag(result.first)) {
-			adapter.read(reinterpret_cast<char*>(&result.second), 1);
-
-			if (this->needSwapEndianess) {
-				result.second = simba::details::swap_uint8(result.first);
-			}
+		if constexpr (simba::details::has_flush<Adapter>::value) {
+			this->output.output->flush();
 		}
-
-		return result;
 	}
 
-	void readElement(adapter_t& adapter, simba_value* value)
+	// bytes written so far, header included
+	std::uint64_t written() const noexcept
 	{
-		auto typeInfo = this->readElementType(adapter);
+		return this->output.position;
+	}
 
-		switch (typeInfo.first) {
-		case simba_type_null:
-			*value = nullptr;
-			break;
-		case simba_type_int8:
-			if (typeInfo.second == simba_type_flag_signed) {
-				*value = this->readNextValue<std::int8_t>(adapter);
+private:
+	// counts what goes through, the position is where a count gets patched later.
+	// Payloads are always copied, the caller's data may be gone before a gathering adapter flushes.
+	struct counted_output
+	{
+		std::streamsize write(const char* buffer, std::streamsize len)
+		{
+			this->output->write(buffer, len);
+			this->position += static_cast<std::uint64_t>(len);
+			return len;
+		}
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_int8(value->get<std::int8_t>());
-				}
-			}
-			else {
-				*value = this->readNextValue<std::uint8_t>(adapter);
+		Adapter* output;
+		std::uint64_t position = 0u;
+	};
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_uint8(value->get<std::uint8_t>());
-				}
-			}
-			break;
-		case simba_type_int16:
-			if (typeInfo.second == simba_type_flag_signed) {
-				*value = this->readNextValue<std::int16_t>(adapter);
+	struct frame
+	{
+		std::uint8_t type = simba_type_array;
+		bool open = false;
+		bool afterKey = false;
+		std::uint32_t count = 0u;
+		std::uint32_t written = 0u;
+		std::uint64_t countOffset = 0u;
+	};
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_int16(value->get<std::int16_t>());
-				}
+	// checks that a value may follow and counts it
+	void element()
+	{
+		if (this->frames.empty()) {
+			if (this->rootWritten) {
+				throw std::exception("The root value has already been written");
 			}
-			else {
-				*value = this->readNextValue<std::uint16_t>(adapter);
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_uint16(value->get<std::uint16_t>());
-				}
-			}
-			break;
-		case simba_type_int32:
-			if (typeInfo.second == simba_type_flag_signed) {
-				*value = this->readNextValue<std::int32_t>(adapter);
+			this->rootWritten = true;
+			return;
+		}
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_int32(value->get<std::int32_t>());
-				}
-			}
-			else {
-				*value = this->readNextValue<std::uint32_t>(adapter);
+		auto& parent = this->frames.back();
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_uint32(value->get<std::uint32_t>());
-				}
+		if (parent.type == simba_type_object) {
+			if (!parent.afterKey) {
+				throw std::exception("Expected a key before the value");
 			}
-			break;
-		case simba_type_int64:
-			if (typeInfo.second == simba_type_flag_signed) {
-				*value = this->readNextValue<std::int64_t>(adapter);
-
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_int64(value->get<std::int64_t>());
-				}
-			}
-			else {
-				*value = this->readNextValue<std::uint64_t>(adapter);
+			parent.afterKey = false;
+		}
 
-				if (this->needSwapEndianess) {
-					*value = simba::details::swap_uint64(value->get<std::uint64_t>());
-				}
-			}
-			break;
-		case simba_type_float:
-			*value = this->readNextValue<float>(adapter);
-			break;
-		case simba_type_double:
-			*value = this->readNextValue<double>(adapter);
-			break;
-		case simba_type_object:
-			*value = simba::object();
-			this->readObject(adapter, value);
-			break;
-		case simba_type_array:
-			*value = simba::array();
-			this->readArray(adapter, value);
-			break;
-		case simba_type_string8:
-			this->readString<char>(adapter, value);
-			break;
-		case simba_type_string16:
-			this->readString<char16_t>(adapter, value);
-			break;
-		case simba_type_string32:
-			this->readString<char32_t>(adapter, value);
-			break;
-		case simba_type_string_w:
-			this->readString<wchar_t>(adapter, value);
-			break;
+		if (!parent.open && parent.written == parent.count) {
+			throw std::exception("More elements were written than the container declared");
+		}
 
-		default:
-			throw std::exception("Unknown simba_value type read, corrupted file?");
-			break;
+		if (parent.written == UINT32_MAX) {
+			throw std::exception("Too many elements in the container");
 		}
+
+		++parent.written;
 	}
 
-	void readObject(adapter_t& adapter, simba_value* value)
+	simba_writer& begin(std::uint8_t type, std::uint32_t count, bool open)
 	{
-		auto objSize = this->getSize(adapter);
+		// checked before anything is written, an open count the adapter can't patch would corrupt the output
+		if (open && !this->canOverwrite()) {
+			throw std::exception("The output can't be overwritten, pass the count up front");
+		}
 
-		for (auto i = 0u; i < objSize; ++i) {
-			simba_value index{ nullptr },
-				element{ nullptr };
+		this->element();
 
-			this->readElement(adapter, &index);
-			this->readElement(adapter, &element);
+		frame next{};
+		next.type = type;
+		next.open = open;
+		next.count = count;
+
+		if (!open && count < 16u) {
+			const auto tag = static_cast<std::uint8_t>((type == simba_type_array ? simba::details::SIMBA_TAG_FIXARRAY : simba::details::SIMBA_TAG_FIXOBJECT) | count);
+			this->output.write(reinterpret_cast<const char*>(&tag), 1);
+		}
+		else {
+			this->serializer.writeElementType(this->output, type, simba_type_flag_signed);
 
-			(*value)[index.get<std::string>()] = std::move(element);
+			if (open) {
+				next.countOffset = this->output.position;
+				this->writeCount(0u);
+			}
+			else {
+				this->serializer.writeSize(this->output, count);
+			}
 		}
+
+		this->frames.push_back(next);
+		return *this;
 	}
 
-	void readArray(adapter_t& adapter, simba_value* value)
+	simba_writer& end(std::uint8_t type)
 	{
-		auto arrSize = this->getSize(adapter);
-		auto& arr = value->getArray();
-		arr.resize(arrSize);
-
-		for (auto i = 0u; i < arrSize; ++i) {
-			simba_value element{ nullptr };
+		if (this->frames.empty() || this->frames.back().type != type) {
+			throw std::exception("The container being ended isn't the innermost open one");
+		}
 
-			this->readElement(adapter, &element);
+		const auto current = this->frames.back();
 
-			arr[i] = std::move(element);
+		if (current.afterKey) {
+			throw std::exception("Expected a value after the key");
 		}
-	}
 
-	template<typename CharType = char>
-	void readString(adapter_t& adapter, simba_value* value)
-	{
-		std::basic_string<CharType> str;
-		auto strCharSize = this->getSize(adapter);
-		auto strLen = this->getSize(adapter);
+		if (!current.open && current.written != current.count) {
+			throw std::exception("Fewer elements were written than the container declared");
+		}
 
-		str.resize(strLen);
+		this->frames.pop_back();
 
-		adapter.read(reinterpret_cast<char*>(str.data()), strCharSize * strLen);
+		if constexpr (simba::details::has_overwrite<Adapter>::value) {
+			if (current.open) {
+				char buffer[simba::details::SIMBA_WRITER_COUNT_BYTES];
+				simba_writer::encodeCount(buffer, current.written);
+				this->output.output->overwrite(current.countOffset, buffer, sizeof(buffer));
+			}
+		}
 
-		// Assign str
-		*value = std::move(str);
+		return *this;
 	}
 
-	std::uint32_t getSize(adapter_t& adapter)
+	// adapters without canOverwrite() are taken at their word if they have an overwrite()
+	bool canOverwrite() const
 	{
-		static_assert(sizeof(std::uint32_t) == 4, "Invalid integer size type");
-		std::uint32_t sz{ 0u };
-		adapter.read(reinterpret_cast<char*>(&sz), sizeof(std::uint32_t));
-
-		if (this->needSwapEndianess) {
-			sz = simba::details::swap_uint32(sz);
+		if constexpr (simba::details::has_can_overwrite<Adapter>::value) {
+			return this->output.output->canOverwrite();
+		}
+		else {
+			return simba::details::has_overwrite<Adapter>::value;
 		}
-
-		return sz;
 	}
 
-	template<typename T>
-	T readNextValue(adapter_t& adapter)
+	// a varint that always takes SIMBA_WRITER_COUNT_BYTES, readers accept the redundant continuation bytes
+	static void encodeCount(char* buffer, std::uint32_t count)
 	{
-		T t{ 0 };
-
-		auto size = this->getSize(adapter);
-
-		if (size > sizeof(T)) {
-			throw std::exception("Cannot read value into T because stored size is larger than size of T");
+		for (std::size_t i = 0u; i < simba::details::SIMBA_WRITER_COUNT_BYTES - 1u; ++i, count >>= 7) {
+			buffer[i] = static_cast<char>((count & 0x7Fu) | 0x80u);
 		}
 
-		adapter.read(reinterpret_cast<char*>(&t), size);
-		return t;
+		buffer[simba::details::SIMBA_WRITER_COUNT_BYTES - 1u] = static_cast<char>(count);
 	}
 
+	void writeCount(std::uint32_t count)
+	{
+		char buffer[simba::details::SIMBA_WRITER_COUNT_BYTES];
+		simba_writer::encodeCount(buffer, count);
+		this->output.write(buffer, sizeof(buffer));
+	}
 
-private:
-	simba_value* value;
-	bool needSwapEndianess = false;
+	counted_output output;
+	simba::details::simba_serializer serializer;
+	std::vector<frame> frames;
+	bool rootWritten = false;
 };
 
 simba::details::simba_serializer simba::simba_value::serialize() const
@@ -1895,6 +7833,23 @@ simba::details::simba_deserializer simba::simba_value::deserialize()
 	return { this };
 }
 
+std::size_t simba::simba_value::serializedSize() const
+{
+	return this->serialize().size();
+}
+
+simba::details::simba_serializer simba::simba_document::serialize() const
+{
+	return this->rootValue.serialize();
+}
+
+// the previous tree is dropped so the decoded one reuses the arena from the start
+simba::details::simba_deserializer simba::simba_document::deserialize()
+{
+	this->clear();
+	return { &this->rootValue, &this->arena };
+}
+
 static std::basic_ostream<char>& operator<<(std::basic_ostream<char> & output, const simba::simba_value & value)
 {
 	simba::details::simba_stream_output_adapter adapter{ output };
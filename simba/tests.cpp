@@ -0,0 +1,637 @@
+#include "include/simba/simba.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Regression tests, returns non-zero if any check fails.
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition) {
+			std::cout << "FAILED: " << what << std::endl;
+			++failures;
+		}
+	}
+
+	// A key re-acquired while its last holder is still releasing it gets a fresh entry. The index node must
+	// be re-keyed to the fresh entry's string, the old one is freed when the release finishes.
+	void keyReacquiredDuringRelease()
+	{
+		auto& table = simba::simba_key_table::global();
+		const auto keys = table.size();
+
+		auto* old = table.acquire("reacquired-during-release");
+
+		// as if release() just dropped the last reference and hasn't taken the lock yet
+		old->refs.store(0u);
+		auto* fresh = table.acquire("reacquired-during-release");
+		check(fresh != old, "a released entry is not revived");
+
+		// finish that release, which frees the old entry
+		old->refs.store(1u);
+		table.release(old);
+
+		auto* again = table.acquire("reacquired-during-release");
+		check(again == fresh, "the fresh entry is found after the old one is freed");
+		check(table.size() == keys + 1u, "the key is in the table once");
+
+		table.release(again);
+		table.release(fresh);
+		check(table.size() == keys, "the key is freed with its last holder");
+	}
+
+	// A deserializer hands out the key it acquired first for every repeat of it and gives its references back
+	// when it's done, so the table is left as it was once the decoded value is gone.
+	void deserializerKeyCache()
+	{
+		auto& table = simba::simba_key_table::global();
+		const auto keys = table.size();
+
+		auto records = simba::array();
+		for (int i = 0; i < 100; ++i) {
+			records.emplaceBack(simba::object(simba::pair("cached-key", i), simba::pair("record-" + std::to_string(i), i)));
+		}
+
+		const auto bytes = records.serialize().toString();
+		records = simba::val();
+		check(table.size() == keys, "the keys are freed with the original");
+
+		{
+			auto decoded = simba::val();
+			decoded.deserialize().fromString(bytes);
+
+			const simba::simba_key key{ "cached-key" };
+			bool same = decoded.getArray().size() == 100u;
+
+			for (auto& record : decoded.getArray()) {
+				same = same && record.getObject().begin()->first == key && record["cached-key"].get<int>() >= 0;
+			}
+
+			check(same, "every repeat of a key decodes to the pooled key");
+			check(table.size() == keys + 101u, "each distinct key is pooled once");
+		}
+
+		check(table.size() == keys, "the deserializer releases the keys it cached");
+	}
+
+	// Copying a shared subtree out of a document has to copy it onto the heap, a reference into the arena
+	// would dangle once the document is cleared.
+	void documentCopyOutlivesClear()
+	{
+		simba::simba_document doc;
+		doc.root() = doc.object();
+		doc.root()["list"] = doc.array();
+		doc.root()["list"].emplaceBack("element");
+		doc.root()["list"].emplaceBack(doc.array());
+		doc.root()["list"][1].emplaceBack(42);
+
+		auto shared = doc.root()["list"].share();
+		simba::simba_value copy = doc.root()["list"];
+		simba::simba_value root = doc.root();
+
+		check(copy == doc.root()["list"], "the copy equals the original");
+
+		// values from share() may not outlive the document
+		shared = nullptr;
+		doc.clear();
+
+		check(copy.getArray().size() == 2u, "the copy survives clear()");
+		check(copy[0].get<std::string>() == "element", "copied strings survive clear()");
+		check(copy[1][0].get<std::int32_t>() == 42, "nested containers are copied too");
+		check(root["list"][1][0].get<std::int32_t>() == 42, "copies of the root survive clear()");
+	}
+
+	template<typename Function>
+	bool throws(Function function)
+	{
+		try {
+			function();
+		}
+		catch (const std::exception&) {
+			return true;
+		}
+
+		return false;
+	}
+
+	// A v2 varint that doesn't fit the declared integer type is rejected instead of truncated.
+	void integerOutOfRange()
+	{
+		const auto narrow = simba::val(static_cast<std::int16_t>(300)).serialize().toString();
+		const auto wide = simba::val(static_cast<std::int32_t>(1 << 20)).serialize().toString();
+
+		// same header, the int16 tag followed by the int32's varint
+		const auto tag = std::mismatch(narrow.begin(), narrow.end(), wide.begin()).first - narrow.begin();
+		const auto corrupt = narrow.substr(0, tag + 1) + wide.substr(tag + 1);
+
+		auto value = simba::val();
+		check(throws([&] { value.deserialize().fromString(narrow); }) == false, "an int16 in range decodes");
+		check(value.get<std::int16_t>() == 300, "an int16 in range keeps its value");
+		check(throws([&] { value.deserialize().fromString(corrupt); }), "the deserializer rejects an int16 out of range");
+
+		simba::simba_view view{ std::string_view{ corrupt } };
+		check(throws([&] { view.root().get<std::int16_t>(); }), "the view rejects an int16 out of range");
+
+		simba::details::simba_memory_input_adapter adapter{ corrupt.data(), corrupt.size() };
+		simba::simba_reader reader{ adapter };
+		check(throws([&] { reader.next(); reader.get<std::int16_t>(); }), "the reader rejects an int16 out of range");
+	}
+
+	// The vector kernels swap whole registers and the scalar loop the tail, together they reverse every element.
+	template<typename T>
+	void swapBuffer()
+	{
+		for (std::size_t count : { 1u, 3u, 15u, 16u, 17u, 33u, 64u }) {
+			std::vector<T> values(count);
+
+			for (std::size_t i = 0u; i < count; ++i) {
+				values[i] = static_cast<T>(0x0102030405060708ull * (i + 1u));
+			}
+
+			auto swapped = values;
+			simba::details::swap_buffer(swapped.data(), count);
+
+			bool reversed = true;
+			for (std::size_t i = 0u; i < count; ++i) {
+				reversed = reversed && swapped[i] == simba::details::swap_integer(values[i]);
+			}
+
+			check(reversed, "swap_buffer reverses the bytes of every element");
+		}
+	}
+
+	// packIntegers() only packs an array when that is smaller than its regular encoding, where int32 0-127 take
+	// one byte each and 0-3 of any integer type too.
+	void packedNeverLarger()
+	{
+		auto fixints = simba::array();
+		auto tinyints = simba::array();
+
+		for (int i = 0; i < 20; ++i) {
+			fixints.emplaceBack(i % 2 == 0 ? 0 : 127);
+			tinyints.emplaceBack(static_cast<std::uint64_t>(i % 2 == 0 ? 0u : 3u));
+		}
+
+		check(fixints.serialize().packIntegers().size() <= fixints.serialize().size(), "small int32 arrays aren't packed into more bytes");
+		check(tinyints.serialize().packIntegers().size() <= tinyints.serialize().size(), "tiny integer arrays aren't packed into more bytes");
+
+		auto timestamps = simba::array();
+		for (std::int64_t i = 0; i < 100; ++i) {
+			timestamps.emplaceBack(1700000000000 + i * 1000 + i % 7);
+		}
+
+		check(timestamps.serialize().packIntegers().size() < timestamps.serialize().size(), "timestamps are still packed");
+	}
+
+	// An open count on an adapter that can't patch it is refused before the writer emits anything for it.
+	void writerOpenCountNeedsOverwrite()
+	{
+		simba::details::simba_size_output_adapter size;
+		simba::simba_writer<simba::details::simba_size_output_adapter> writer{ size };
+		const auto header = size.size();
+
+		check(throws([&] { writer.beginArray(); }), "beginArray() without a count throws on the size adapter");
+		check(size.size() == header, "nothing is written for the refused array");
+
+		std::stringstream seekable;
+		simba::details::simba_stream_output_adapter stream{ seekable };
+		check(stream.canOverwrite(), "a seekable stream can be overwritten");
+
+		std::vector<char> buffer;
+		simba::details::simba_buffer_output_adapter<std::vector<char>> output{ buffer };
+		simba::simba_writer<simba::details::simba_buffer_output_adapter<std::vector<char>>> open{ output };
+		open.beginArray().value(1).value(2).endArray().finish();
+
+		auto decoded = simba::val();
+		decoded.deserialize().fromBuffer(buffer);
+		check(decoded == simba::array(1, 2), "a patched count decodes");
+	}
+
+	// records with repeated strings, packable timestamps and an object large enough to be indexed
+	simba::simba_value makeRecords()
+	{
+		auto records = simba::array();
+
+		for (std::int64_t i = 0; i < 100; ++i) {
+			auto timestamps = simba::array();
+
+			for (std::int64_t j = 0; j < 20; ++j) {
+				timestamps.emplaceBack(1700000000000 + i * 100000 + j * 1000 + j % 3);
+			}
+
+			records.emplaceBack(simba::object(
+				simba::pair("id", i),
+				simba::pair("level", std::string(i % 3 == 0 ? "error" : "info")),
+				simba::pair("host", "host-" + std::to_string(i % 4)),
+				simba::pair("name", std::string(40u + static_cast<std::size_t>(i % 5), 'n')),
+				simba::pair("timestamps", std::move(timestamps)),
+				simba::pair("samples", simba::typed_array(std::vector<std::int32_t>{ 1, -2, static_cast<std::int32_t>(i) }))
+			));
+		}
+
+		auto fields = simba::object();
+
+		for (int i = 0; i < 80; ++i) {
+			fields.emplace("field-" + std::to_string(i), i);
+		}
+
+		return simba::object(
+			simba::pair("records", std::move(records)),
+			simba::pair("fields", std::move(fields)),
+			simba::pair("wide", std::wstring(L"wide")),
+			simba::pair("empty", simba::array())
+		);
+	}
+
+	// options is a mask of deduplicate (1), packIntegers (2), compress (4) and index (8)
+	std::string encode(const simba::simba_value& value, unsigned options)
+	{
+		auto serializer = value.serialize();
+		serializer.deduplicate((options & 1u) != 0u).packIntegers((options & 2u) != 0u).compress((options & 4u) != 0u).index((options & 8u) != 0u);
+		return serializer.toString();
+	}
+
+	// Every combination of the v2 options that can be combined decodes back to the same value, and uncompressed
+	// output can be viewed.
+	void serializerOptions()
+	{
+		const auto value = makeRecords();
+		const auto plain = encode(value, 0u);
+
+		for (unsigned options = 0u; options < 16u; ++options) {
+			if ((options & 4u) != 0u && (options & 8u) != 0u) {
+				check(throws([&] { encode(value, options); }), "an index can't be combined with compression");
+				continue;
+			}
+
+			const auto bytes = encode(value, options);
+
+			auto decoded = simba::val();
+			check(throws([&] { decoded.deserialize().fromString(bytes); }) == false && decoded == value, "every combination of options round trips");
+
+			if ((options & 1u) != 0u || (options & 2u) != 0u) {
+				check(bytes.size() < plain.size(), "string tables and packing make the records smaller");
+			}
+
+			if ((options & 4u) != 0u) {
+				check(throws([&] { simba::simba_view{ std::string_view{ bytes } }; }), "compressed output can't be viewed");
+				continue;
+			}
+
+			simba::simba_view view{ std::string_view{ bytes } };
+			const auto record = view.root()["records"][77u];
+			check(record["id"].get<std::int64_t>() == 77 && record["host"].get<std::string_view>() == "host-1", "records are found through the view");
+			check(record["timestamps"][19u].get<std::int64_t>() == 1700000000000 + 77 * 100000 + 19 * 1000 + 1, "the last timestamp is found through the view");
+			check(view.root()["fields"]["field-63"].get<std::int32_t>() == 63, "keys of a large object are found through the view");
+		}
+	}
+
+	// A view walks, finds and iterates the same values the deserializer decodes, packed arrays included.
+	void viewAccess()
+	{
+		const auto value = makeRecords();
+
+		for (const unsigned options : { 0u, 1u, 2u, 8u, 11u }) {
+			const auto bytes = encode(value, options);
+			simba::simba_view view{ std::string_view{ bytes } };
+			const auto root = view.root();
+
+			check(root.getType() == simba::simba_type_object && root.size() == 4u, "the view sees the root object");
+			check(root.find("missing").has_value() == false && throws([&] { root["missing"]; }), "missing keys aren't found");
+			check(root["fields"].find("field-79").has_value() && root["fields"].find("field-80").has_value() == false, "find() on a large object");
+			check(throws([&] { root["records"][100u]; }), "indexing past the end throws");
+			check(throws([&] { root["records"][0u]["id"].get<std::int32_t>(); }), "get() wants the stored type");
+			check(root["records"][0u]["id"].cast<double>() == 0.0, "cast() converts");
+			check(root["wide"].get<std::wstring>() == L"wide", "wide strings are copied out");
+			check(root["empty"].begin() == root["empty"].end(), "an empty array has no elements");
+
+			std::vector<std::string> keys;
+			for (auto it = root.begin(); it != root.end(); ++it) {
+				keys.emplace_back(it.key());
+			}
+			check(keys == std::vector<std::string>{ "empty", "fields", "records", "wide" }, "an object iterates its keys in order");
+
+			std::int64_t ids = 0;
+			std::uint32_t records = 0u;
+			bool timestamps = true;
+
+			for (const auto record : root["records"]) {
+				ids += record["id"].get<std::int64_t>();
+				const auto& original = value["records"][records++]["timestamps"].getArray();
+
+				std::uint32_t index = 0u;
+				for (const auto timestamp : record["timestamps"]) {
+					timestamps = timestamps && timestamp.get<std::int64_t>() == original[index].get<std::int64_t>()
+						&& record["timestamps"][index].get<std::int64_t>() == original[index].get<std::int64_t>();
+					++index;
+				}
+
+				timestamps = timestamps && index == original.size();
+			}
+
+			check(records == 100u && ids == 99 * 100 / 2, "an array iterates every element");
+			check(timestamps, "iterating and indexing a packed array give the stored values");
+
+			std::vector<std::int32_t> samples;
+			for (const auto sample : root["records"][5u]["samples"]) {
+				samples.push_back(sample.get<std::int32_t>());
+			}
+			check(samples == std::vector<std::int32_t>{ 1, -2, 5 } && root["records"][5u]["samples"].size() == 3u, "typed arrays are viewed element by element");
+		}
+	}
+
+	// A reader sums the same numbers the tree holds, whatever options the input was written with.
+	void readerEvents()
+	{
+		const auto value = makeRecords();
+		std::int64_t expected = 0;
+
+		for (const auto& record : value["records"].getArray()) {
+			for (const auto& timestamp : record["timestamps"].getArray()) {
+				expected += timestamp.get<std::int64_t>();
+			}
+		}
+
+		for (unsigned options = 0u; options < 12u; ++options) {
+			if ((options & 4u) != 0u && (options & 8u) != 0u) {
+				continue;
+			}
+
+			const auto bytes = encode(value, options);
+			simba::details::simba_memory_input_adapter adapter{ bytes.data(), bytes.size() };
+			simba::simba_reader reader{ adapter };
+
+			std::int64_t ids = 0;
+			std::int64_t timestamps = 0;
+			std::size_t hosts = 0u;
+			bool arrays = true;
+
+			while (reader.next() != simba::simba_event_end_of_input) {
+				if (reader.event() != simba::simba_event_key) {
+					continue;
+				}
+
+				if (reader.key() == "id") {
+					reader.next();
+					ids += reader.get<std::int64_t>();
+				}
+				else if (reader.key() == "host") {
+					reader.next();
+					hosts += reader.event() == simba::simba_event_string && reader.chunk().substr(0, 5) == "host-" && reader.isLastChunk() ? 1u : 0u;
+				}
+				else if (reader.key() == "timestamps") {
+					reader.next();
+					arrays = arrays && reader.event() == simba::simba_event_begin_array && reader.size() == 20u;
+
+					while (reader.next() == simba::simba_event_value) {
+						timestamps += reader.get<std::int64_t>();
+					}
+
+					arrays = arrays && reader.event() == simba::simba_event_end_array;
+				}
+				else if (reader.key() != "records") {
+					reader.skip();
+				}
+			}
+
+			check(ids == 99 * 100 / 2 && hosts == 100u, "the reader sees every record");
+			check(arrays && timestamps == expected, "the reader reads packed arrays as arrays of values");
+		}
+	}
+
+	// skip() leaves the reader on the end of a container, after the value of a key or after the whole string.
+	void readerSkip()
+	{
+		const auto value = simba::object(
+			simba::pair("a", simba::array(1, simba::array(2, 3), "x")),
+			simba::pair("b", std::string(100000u, 'b')),
+			simba::pair("c", simba::object(simba::pair("d", 4))),
+			simba::pair("e", 7)
+		);
+
+		for (const unsigned options : { 0u, 1u, 4u }) {
+			const auto bytes = encode(value, options);
+			simba::details::simba_memory_input_adapter adapter{ bytes.data(), bytes.size() };
+			simba::simba_reader reader{ adapter };
+
+			check(reader.next() == simba::simba_event_begin_object && reader.size() == 4u, "the root object begins");
+			check(reader.next() == simba::simba_event_key && reader.key() == "a", "the first key");
+			check(reader.next() == simba::simba_event_begin_array && reader.size() == 3u, "an array begins");
+
+			reader.skip();
+			check(reader.event() == simba::simba_event_end_array && reader.depth() == 1u, "skipping an array ends on its end event");
+
+			check(reader.next() == simba::simba_event_key && reader.key() == "b", "the key after the skipped array");
+			check(reader.next() == simba::simba_event_string && reader.length() == 100000u, "a long string begins");
+			check(!reader.chunk().empty() && reader.chunk().size() < 100000u && !reader.isLastChunk(), "a long string comes in chunks");
+
+			reader.skip();
+			check(reader.next() == simba::simba_event_key && reader.key() == "c", "skipping a string skips all of its chunks");
+
+			reader.skip();
+			check(reader.next() == simba::simba_event_key && reader.key() == "e", "skipping after a key skips its value");
+			check(reader.next() == simba::simba_event_value && reader.get<std::int32_t>() == 7, "the value after the skipped pair");
+			check(reader.next() == simba::simba_event_end_object && reader.next() == simba::simba_event_end_of_input, "the input ends after the root");
+		}
+	}
+
+	using buffer_writer = simba::simba_writer<simba::details::simba_buffer_output_adapter<std::vector<char>>>;
+
+	// Open counts are patched in when their container ends, counted containers are written like serialize() writes them.
+	void writerOutput()
+	{
+		auto expected = simba::object(
+			simba::pair("name", "writer"),
+			simba::pair("values", simba::array()),
+			simba::pair("pair", simba::object(simba::pair("x", 1.5), simba::pair("y", nullptr))),
+			simba::pair("samples", simba::typed_array(std::vector<std::uint16_t>{ 1u, 2u, 3u })),
+			simba::pair("tree", simba::array("a", "b"))
+		);
+
+		for (int i = 0; i < 300; ++i) {
+			expected["values"].emplaceBack(i);
+		}
+
+		const std::uint16_t samples[] = { 1u, 2u, 3u };
+
+		std::vector<char> open;
+		simba::details::simba_buffer_output_adapter<std::vector<char>> openOutput{ open };
+		buffer_writer openWriter{ openOutput };
+		openWriter.beginObject().key("name").value("writer").key("values").beginArray();
+
+		for (int i = 0; i < 300; ++i) {
+			openWriter.value(i);
+		}
+
+		openWriter.endArray().key("pair").beginObject().key("x").value(1.5).key("y").value(nullptr).endObject();
+		openWriter.key("samples").typedArray(samples, 3u).key("tree").value(simba::array("a", "b")).endObject().finish();
+
+		auto decoded = simba::val();
+		decoded.deserialize().fromBuffer(open);
+		check(decoded == expected, "open counts are patched in");
+		check(openWriter.written() == open.size(), "written() counts the header and every value");
+
+		std::vector<char> counted;
+		simba::details::simba_buffer_output_adapter<std::vector<char>> countedOutput{ counted };
+		buffer_writer countedWriter{ countedOutput };
+		countedWriter.beginObject(5u).key("name").value("writer").key("values").beginArray(300u);
+
+		for (int i = 0; i < 300; ++i) {
+			countedWriter.value(i);
+		}
+
+		countedWriter.endArray().key("pair").beginObject(2u).key("x").value(1.5).key("y").value(nullptr).endObject();
+		countedWriter.key("samples").typedArray(samples, 3u).key("tree").value(simba::array("a", "b")).endObject().finish();
+
+		// the keys weren't given in sorted order like serialize() writes them, so only the decoded value can match
+		auto ordered = simba::val();
+		ordered.deserialize().fromBuffer(counted);
+		check(ordered == expected, "counted containers decode");
+
+		std::vector<char> sorted;
+		simba::details::simba_buffer_output_adapter<std::vector<char>> sortedOutput{ sorted };
+		buffer_writer sortedWriter{ sortedOutput };
+		sortedWriter.beginObject(1u).key("values").beginArray(300u);
+
+		for (int i = 0; i < 300; ++i) {
+			sortedWriter.value(i);
+		}
+
+		sortedWriter.endArray().endObject().finish();
+		const auto tree = simba::object(simba::pair("values", expected["values"])).serialize().toString();
+		check(std::string(sorted.begin(), sorted.end()) == tree, "counted containers are written like serialize() writes them");
+
+		// the count is patched after the chunk it's in went to the stream
+		std::stringstream stream;
+		{
+			simba::details::simba_stream_output_adapter output{ stream };
+			simba::simba_writer<simba::details::simba_stream_output_adapter> writer{ output };
+			writer.beginArray();
+
+			for (int i = 0; i < 4000; ++i) {
+				writer.value(static_cast<std::int64_t>(i) << 40);
+			}
+
+			writer.endArray().finish();
+		}
+
+		decoded.deserialize().fromString(stream.str());
+		check(decoded.getArray().size() == 4000u && decoded[3999].get<std::int64_t>() == std::int64_t{ 3999 } << 40, "a seekable stream is patched after it was flushed");
+	}
+
+	// Misuse throws where it happens instead of producing output that can't be read.
+	void writerErrors()
+	{
+		const auto fails = [](auto write) {
+			std::vector<char> buffer;
+			simba::details::simba_buffer_output_adapter<std::vector<char>> output{ buffer };
+			buffer_writer writer{ output };
+			return throws([&] { write(writer); });
+		};
+
+		check(fails([](buffer_writer& writer) { writer.beginArray(2u).value(1).endArray(); }), "fewer elements than declared");
+		check(fails([](buffer_writer& writer) { writer.beginArray(1u).value(1).value(2); }), "more elements than declared");
+		check(fails([](buffer_writer& writer) { writer.beginObject(1u).value(1); }), "a value without a key");
+		check(fails([](buffer_writer& writer) { writer.beginObject().key("a").key("b"); }), "a key after a key");
+		check(fails([](buffer_writer& writer) { writer.beginArray().key("a"); }), "a key in an array");
+		check(fails([](buffer_writer& writer) { writer.beginObject().key("a").endObject(); }), "ending an object after a key");
+		check(fails([](buffer_writer& writer) { writer.beginObject().endArray(); }), "ending the wrong container");
+		check(fails([](buffer_writer& writer) { writer.beginArray().finish(); }), "finishing with an open container");
+		check(fails([](buffer_writer& writer) { writer.finish(); }), "finishing without a root");
+		check(fails([](buffer_writer& writer) { writer.value(1).value(2); }), "a second root");
+		check(fails([](buffer_writer& writer) { writer.beginArray().value(1).endArray().finish(); }) == false, "a complete value");
+	}
+
+#if defined(SIMBA_HAS_WRITEV) || defined(SIMBA_HAS_MMAP)
+	template<typename Function>
+	std::error_code systemError(Function function)
+	{
+		try {
+			function();
+		}
+		catch (const std::system_error& error) {
+			return error.code();
+		}
+
+		return {};
+	}
+#endif
+
+#if defined(SIMBA_HAS_WRITEV)
+	// Write errors carry errno, and an adapter destroyed with output it can't write doesn't throw.
+	void fdOutputErrors()
+	{
+		check(systemError([] {
+			simba::details::simba_fd_output_adapter adapter{ -1 };
+			adapter.write("simba", 5);
+			adapter.flush();
+		}) == std::errc::bad_file_descriptor, "a failed flush throws a system_error with errno");
+
+		check(throws([] {
+			simba::details::simba_fd_output_adapter adapter{ -1 };
+			adapter.write("simba", 5);
+		}) == false, "destroying an adapter that can't write doesn't throw");
+
+		check(systemError([] { simba::val(1).serialize().to("/nonexistent-simba-dir/out.simba"); }) == std::errc::no_such_file_or_directory,
+			"to(filename) reports why the file couldn't be opened");
+	}
+#endif
+
+#if defined(SIMBA_HAS_MMAP)
+	// from(filename) decodes through a mapping of the file and reports why a file can't be read.
+	void mappedFileInput()
+	{
+		const auto value = simba::object(
+			simba::pair("name", "mapped"),
+			simba::pair("values", simba::array(1, 2, 3))
+		);
+		value.serialize().to("simba-tests-mapped.simba");
+
+		auto decoded = simba::val();
+		decoded.deserialize().from("simba-tests-mapped.simba");
+		check(decoded == value, "a file written with to() reads back through the mapping");
+		::unlink("simba-tests-mapped.simba");
+
+		check(systemError([&] { decoded.deserialize().from("/nonexistent-simba-dir/in.simba"); }) == std::errc::no_such_file_or_directory,
+			"from(filename) reports why the file couldn't be opened");
+	}
+#endif
+}
+
+int main()
+{
+	keyReacquiredDuringRelease();
+	deserializerKeyCache();
+	documentCopyOutlivesClear();
+	integerOutOfRange();
+	swapBuffer<std::uint16_t>();
+	swapBuffer<std::uint32_t>();
+	swapBuffer<std::uint64_t>();
+	packedNeverLarger();
+	writerOpenCountNeedsOverwrite();
+	serializerOptions();
+	viewAccess();
+	readerEvents();
+	readerSkip();
+	writerOutput();
+	writerErrors();
+#if defined(SIMBA_HAS_WRITEV)
+	fdOutputErrors();
+#endif
+#if defined(SIMBA_HAS_MMAP)
+	mappedFileInput();
+#endif
+
+	if (failures != 0) {
+		std::cout << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}